@@ -7,6 +7,8 @@
 #include "threads/io.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "intrinsic.h"
 /* See [8254] for hardware details of the 8254 timer chip. */
 
 #if TIMER_FREQ < 19
@@ -19,6 +21,27 @@
 /* 부팅된 이후의 timer ticks = kernel tick + idle tick */
 static int64_t ticks;	 // 시간 표시
 
+/* timer interrupt 핸들러 안에서 보낸 시간 (TSC cycle) */
+static uint64_t intr_cycles;
+
+/* 한 tick에 해당하는 8254 카운트, 8254 input frequency / TIMER_FREQ */
+#define PIT_TICK_COUNT ((1193180 + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* -tickless: idle일 때 주기적인 tick 대신 one-shot 타이머를 쓸지 여부 */
+bool timer_tickless;
+
+/* Dynamic tick 상태.  idle 스레드만 실행 가능할 때 timer_idle_enter()가
+   다음 깨울 시간까지 8254를 one-shot(mode 0)으로 걸어두고,
+   인터럽트로 깨어나면 주기 모드(mode 2)로 되돌리며 건너뛴 tick을 보정한다. */
+static bool in_idle;			/* idle 스레드가 hlt로 쉬는 중인지 */
+static int64_t oneshot_ticks;	/* one-shot이 끝나면 지나가 있을 tick 수, 0이면 주기 모드 */
+static uint16_t oneshot_count;	/* one-shot에 프로그래밍한 카운트 */
+
+/* Dynamic tick 통계 */
+static int64_t idle_intr_cnt;	/* idle 중에 받은 timer interrupt 수 */
+static int64_t oneshot_cnt;		/* one-shot으로 전환한 횟수 */
+static int64_t skipped_ticks;	/* interrupt 없이 건너뛴 tick 수 */
+
 /* wake 해야 할 time */
 #define WAKE_TIME 0
 
@@ -27,6 +50,9 @@ static int64_t ticks;	 // 시간 표시
 static unsigned loops_per_tick;
 
 static intr_handler_func timer_interrupt;
+static void pit_program (int mode, uint16_t count);
+static uint16_t pit_read_back (bool *out);
+static void skip_ticks (int64_t cnt);
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
@@ -38,11 +64,7 @@ static void real_time_sleep (int64_t num, int32_t denom);
 void
 timer_init (void) {
 	/* 8254 input frequency divided by TIMER_FREQ, rounded to nearest. */
-	uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;		// 8254칩의 주파수
-
-	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
-	outb (0x40, count & 0xff);
-	outb (0x40, count >> 8);
+	pit_program (2, PIT_TICK_COUNT);
 
 	intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
@@ -122,18 +144,154 @@ timer_nsleep (int64_t ns) {
 	real_time_sleep (ns, 1000 * 1000 * 1000);
 }
 
+/* 부팅 이후 timer interrupt 핸들러가 사용한 TSC cycle 수를 반환 */
+uint64_t
+timer_intr_cycles (void) {
+	enum intr_level old_level = intr_disable ();
+	uint64_t cycles = intr_cycles;
+	intr_set_level (old_level);
+	return cycles;
+}
+
+/* idle 스레드가 hlt 하기 직전에 인터럽트가 꺼진 상태로 호출.
+   -tickless라면 다음으로 깨워야 할 스레드의 tick까지 8254를 one-shot으로 건다.
+   8254 카운터는 16비트라서 한 번에 건너뛸 수 있는 tick은 몇 개뿐이다. */
+void
+timer_idle_enter (void) {
+	int64_t deadline, sleep, max_sleep;
+	uint16_t left;
+	bool out;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	/* 이전 one-shot이 아직 남아있으면 먼저 정리 */
+	timer_idle_exit ();
+	in_idle = true;
+	/* MLFQS는 매 tick과 매 초의 계산을 건너뛸 수 없으므로 주기 모드 유지 */
+	if (!timer_tickless || thread_mlfqs)
+		return;
+
+	/* 다음 tick까지 남은 카운트는 그대로 살려서 시간이 밀리지 않게 한다. */
+	left = pit_read_back (&out);
+	if (left == 0 || left > PIT_TICK_COUNT)
+		left = PIT_TICK_COUNT;
+	max_sleep = 1 + (UINT16_MAX - left) / PIT_TICK_COUNT;
+
+	deadline = wq_deadline (thread_wake_deadline (ticks + max_sleep));
+	sleep = deadline - ticks;
+	if (sleep <= 1)
+		return;			/* 어차피 다음 tick에 할 일이 있으면 주기 모드 유지 */
+
+	oneshot_ticks = sleep;
+	oneshot_count = left + (sleep - 1) * PIT_TICK_COUNT;
+	pit_program (0, oneshot_count);
+	oneshot_cnt++;
+}
+
+/* idle 스레드가 CPU를 내놓을 때(schedule) 인터럽트가 꺼진 상태로 호출.
+   one-shot 중에 다른 인터럽트로 깨어났다면 실제로 흐른 tick만큼 ticks를 보정하고
+   주기적인 tick을 다시 시작한다. */
+void
+timer_idle_exit (void) {
+	uint16_t left;
+	int64_t elapsed, first, cnt;
+	bool out;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	in_idle = false;
+	if (oneshot_ticks == 0)
+		return;
+
+	/* one-shot이 이미 끝났다면 대기 중인 timer interrupt가 보정하도록 둔다. */
+	left = pit_read_back (&out);
+	if (out)
+		return;
+
+	/* 첫 tick 경계는 FIRST 카운트 뒤, 그 다음부터는 PIT_TICK_COUNT마다 온다.
+	   tick 경계 사이에서 끊긴 나머지는 가까운 쪽으로 반올림한다. */
+	elapsed = oneshot_count - left;
+	first = oneshot_count - (oneshot_ticks - 1) * PIT_TICK_COUNT;
+	if (elapsed < first)
+		cnt = elapsed * 2 >= first ? 1 : 0;
+	else {
+		cnt = 1 + (elapsed - first) / PIT_TICK_COUNT;
+		if ((elapsed - first) % PIT_TICK_COUNT * 2 >= PIT_TICK_COUNT)
+			cnt++;
+	}
+
+	pit_program (2, PIT_TICK_COUNT);
+	oneshot_ticks = 0;
+	if (cnt > 0) {
+		skip_ticks (cnt);
+		thread_wake (ticks);
+		wq_tick (ticks);
+	}
+}
+
 /* Prints timer statistics. */
 void
 timer_print_stats (void) {
-	printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+	int64_t t = timer_ticks ();
+
+	printf ("Timer: %"PRId64" ticks\n", t);
+	printf ("Timer: %"PRIu64" cycles in interrupt handler (%"PRIu64" per tick)\n",
+			intr_cycles, t > 0 ? intr_cycles / t : 0);
+	printf ("Timer: %"PRId64" idle interrupts, %"PRId64" one-shot, "
+			"%"PRId64" ticks skipped\n",
+			idle_intr_cnt, oneshot_cnt, skipped_ticks);
+}
+
+/* 8254 카운터 0을 MODE로 설정하고 COUNT부터 세게 한다.
+   mode 0: interrupt on terminal count (one-shot), mode 2: rate generator. */
+static void
+pit_program (int mode, uint16_t count) {
+	outb (0x43, 0x30 | (mode << 1));    /* CW: counter 0, LSB then MSB, MODE, binary. */
+	outb (0x40, count & 0xff);
+	outb (0x40, count >> 8);
+}
+
+/* Read-back 명령으로 카운터 0의 남은 카운트와 OUT 핀 상태를 함께 읽는다. */
+static uint16_t
+pit_read_back (bool *out) {
+	uint8_t status, lo, hi;
+
+	outb (0x43, 0xc2);    /* Read-back: latch count and status of counter 0. */
+	status = inb (0x40);
+	lo = inb (0x40);
+	hi = inb (0x40);
+	*out = (status & 0x80) != 0;
+	return lo | (hi << 8);
+}
+
+/* interrupt 없이 지나간 CNT개의 idle tick을 반영 */
+static void
+skip_ticks (int64_t cnt) {
+	ticks += cnt;
+	skipped_ticks += cnt;
+	thread_tick_idle (cnt);
 }
 
 /* Timer interrupt handler. */
 static void
 timer_interrupt (struct intr_frame *args UNUSED) {
+	uint64_t start = rdtsc ();
+
+	if (in_idle)
+		idle_intr_cnt++;
+	if (oneshot_ticks > 0) {
+		/* one-shot이 끝났다: 마지막 tick을 뺀 나머지는 건너뛴 tick */
+		pit_program (2, PIT_TICK_COUNT);
+		skip_ticks (oneshot_ticks - 1);
+		oneshot_ticks = 0;
+	}
+
 	ticks++;	// 시간을 증가시켜 줌
 	thread_tick ();
 	thread_wake(ticks);	// interrupt에서 매 순간 ticks가 증가하므로 깨울 tick이 되면 깨운다
+	wq_tick (ticks);	// 때가 된 delayed work를 workqueue로
+
+	intr_cycles += rdtsc () - start;
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
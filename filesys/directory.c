@@ -4,7 +4,8 @@
 #include <list.h>
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 
 /* A directory. */
 struct dir {
@@ -19,6 +20,23 @@ struct dir_entry {
 	bool in_use;                        /* In use or free? */
 };
 
+/* Orders changes to directory entries against lookups.  Any
+ * number of lookups and readdirs may run at once. */
+static struct rwlock dir_lock;
+
+/* Cache for struct dir. */
+static struct kmem_cache *dir_cache;
+
+/* Initializes the directory module. */
+void
+dir_init (void) {
+	rw_init (&dir_lock);
+	lock_set_name (&dir_lock.lock, "dir_lock");
+	dir_cache = kmem_cache_create ("dir", sizeof (struct dir), NULL);
+	if (dir_cache == NULL)
+		PANIC ("dir_init: out of memory");
+}
+
 /* Creates a directory with space for ENTRY_CNT entries in the
  * given SECTOR.  Returns true if successful, false on failure. */
 bool
@@ -30,14 +48,14 @@ dir_create (disk_sector_t sector, size_t entry_cnt) {
  * it takes ownership.  Returns a null pointer on failure. */
 struct dir *
 dir_open (struct inode *inode) {
-	struct dir *dir = calloc (1, sizeof *dir);
+	struct dir *dir = kmem_cache_alloc (dir_cache);
 	if (inode != NULL && dir != NULL) {
 		dir->inode = inode;
 		dir->pos = 0;
 		return dir;
 	} else {
 		inode_close (inode);
-		free (dir);
+		kmem_cache_free (dir_cache, dir);
 		return NULL;
 	}
 }
@@ -61,7 +79,7 @@ void
 dir_close (struct dir *dir) {
 	if (dir != NULL) {
 		inode_close (dir->inode);
-		free (dir);
+		kmem_cache_free (dir_cache, dir);
 	}
 }
 
@@ -109,10 +127,12 @@ dir_lookup (const struct dir *dir, const char *name,
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
+	rw_read_acquire (&dir_lock);
 	if (lookup (dir, name, &e, NULL))
 		*inode = inode_open (e.inode_sector);
 	else
 		*inode = NULL;
+	rw_read_release (&dir_lock);
 
 	return *inode != NULL;
 }
@@ -136,6 +156,8 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 	if (*name == '\0' || strlen (name) > NAME_MAX)
 		return false;
 
+	rw_write_acquire (&dir_lock);
+
 	/* Check that NAME is not in use. */
 	if (lookup (dir, name, NULL, NULL))
 		goto done;
@@ -159,6 +181,7 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 	success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
 
 done:
+	rw_write_release (&dir_lock);
 	return success;
 }
 
@@ -175,6 +198,8 @@ dir_remove (struct dir *dir, const char *name) {
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
+	rw_write_acquire (&dir_lock);
+
 	/* Find directory entry. */
 	if (!lookup (dir, name, &e, &ofs))
 		goto done;
@@ -194,6 +219,7 @@ dir_remove (struct dir *dir, const char *name) {
 	success = true;
 
 done:
+	rw_write_release (&dir_lock);
 	inode_close (inode);
 	return success;
 }
@@ -204,13 +230,17 @@ done:
 bool
 dir_readdir (struct dir *dir, char name[NAME_MAX + 1]) {
 	struct dir_entry e;
+	bool found = false;
 
+	rw_read_acquire (&dir_lock);
 	while (inode_read_at (dir->inode, &e, sizeof e, dir->pos) == sizeof e) {
 		dir->pos += sizeof e;
 		if (e.in_use) {
 			strlcpy (name, e.name, NAME_MAX + 1);
-			return true;
+			found = true;
+			break;
 		}
 	}
-	return false;
+	rw_read_release (&dir_lock);
+	return found;
 }
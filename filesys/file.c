@@ -1,28 +1,42 @@
 #include "filesys/file.h"
 #include <debug.h>
 #include "filesys/inode.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 
 /* An open file. */
 struct file {
 	struct inode *inode;        /* File's inode. */
 	off_t pos;                  /* Current position. */
 	bool deny_write;            /* Has file_deny_write() been called? */
+	struct lock pos_lock;       /* Serializes reads and writes that use POS. */
 };
 
+/* Cache for struct file. */
+static struct kmem_cache *file_cache;
+
+/* Initializes the file module. */
+void
+file_init (void) {
+	file_cache = kmem_cache_create ("file", sizeof (struct file), NULL);
+	if (file_cache == NULL)
+		PANIC ("file_init: out of memory");
+}
+
 /* 주어진 INODE를 소유하도록 파일을 열고 새로운 파일을 반환하며,
    할당에 실패하거나 INODE가 null인 경우 null 포인터 반환 */
 struct file *
 file_open (struct inode *inode) {
-	struct file *file = calloc (1, sizeof *file);
+	struct file *file = kmem_cache_alloc (file_cache);
 	if (inode != NULL && file != NULL) {
 		file->inode = inode;
 		file->pos = 0;
 		file->deny_write = false;
+		lock_init (&file->pos_lock);
 		return file;
 	} else {
 		inode_close (inode);
-		free (file);
+		kmem_cache_free (file_cache, file);
 		return NULL;
 	}
 }
@@ -53,7 +67,7 @@ file_close (struct file *file) {
 	if (file != NULL) {
 		file_allow_write (file);
 		inode_close (file->inode);
-		free (file);
+		kmem_cache_free (file_cache, file);
 	}
 }
 
@@ -65,11 +79,16 @@ file_get_inode (struct file *file) {
 
 /* FILE에서 현재 위치에서 시작하여 BUFFER로 SIZE 바이트를 읽어옵니다.
 실제로 읽어온 바이트 수를 반환하며, 파일 끝에 도달하면 SIZE보다 적을 수 있습니다.
-읽어온 바이트 수만큼 FILE의 위치를 이동합니다. */
+읽어온 바이트 수만큼 FILE의 위치를 이동합니다.
+같은 FILE을 함께 쓰는 스레드들은 서로 겹치지 않는 구간을 읽습니다. */
 off_t
 file_read (struct file *file, void *buffer, off_t size) {
-	off_t bytes_read = inode_read_at (file->inode, buffer, size, file->pos);
+	off_t bytes_read;
+
+	lock_acquire (&file->pos_lock);
+	bytes_read = inode_read_at (file->inode, buffer, size, file->pos);
 	file->pos += bytes_read;
+	lock_release (&file->pos_lock);
 	return bytes_read;
 }
 
@@ -91,8 +110,12 @@ file_read_at (struct file *file, void *buffer, off_t size, off_t file_ofs) {
  * Advances FILE's position by the number of bytes read. */
 off_t
 file_write (struct file *file, const void *buffer, off_t size) {
-	off_t bytes_written = inode_write_at (file->inode, buffer, size, file->pos);
+	off_t bytes_written;
+
+	lock_acquire (&file->pos_lock);
+	bytes_written = inode_write_at (file->inode, buffer, size, file->pos);
 	file->pos += bytes_written;
+	lock_release (&file->pos_lock);
 	return bytes_written;
 }
 
@@ -144,7 +167,9 @@ void
 file_seek (struct file *file, off_t new_pos) {
 	ASSERT (file != NULL);
 	ASSERT (new_pos >= 0);
+	lock_acquire (&file->pos_lock);
 	file->pos = new_pos;
+	lock_release (&file->pos_lock);
 }
 
 /* Returns the current position in FILE as a byte offset from the
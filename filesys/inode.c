@@ -5,7 +5,11 @@
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
+#include "threads/rcu.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -34,6 +38,7 @@ struct inode {
 	bool removed;                       /* True if deleted, false otherwise. */
 	int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
 	struct inode_disk data;             /* Inode content. */
+	struct rcu_head rcu;                /* Deferred free after last close. */
 };
 
 /* Returns the disk sector that contains byte offset POS within
@@ -50,13 +55,28 @@ byte_to_sector (const struct inode *inode, off_t pos) {
 }
 
 /* List of open inodes, so that opening a single inode twice
- * returns the same `struct inode'. */
+ * returns the same `struct inode'.  Searched under RCU; insertions
+ * and removals are serialized by open_inodes_lock, and a closed
+ * inode is freed only after a grace period. */
 static struct list open_inodes;
+static struct lock open_inodes_lock;
+
+/* Cache for struct inode. */
+static struct kmem_cache *inode_cache;
+
+static struct inode *inode_lookup (disk_sector_t);
+static bool inode_get (struct inode *);
+static void inode_free (struct rcu_head *);
 
 /* Initializes the inode module. */
 void
 inode_init (void) {
 	list_init (&open_inodes);
+	lock_init (&open_inodes_lock);
+	inode_cache = kmem_cache_create ("inode", sizeof (struct inode), NULL);
+	if (inode_cache == NULL)
+		PANIC ("inode_init: out of memory");
+	lock_set_name (&open_inodes_lock, "open_inodes");
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -101,39 +121,75 @@ inode_create (disk_sector_t sector, off_t length) {
  * Returns a null pointer if memory allocation fails. */
 struct inode *
 inode_open (disk_sector_t sector) {
-	struct list_elem *e;
 	struct inode *inode;
-	
-	/* Check whether this inode is already open. */
+
+	/* Check whether this inode is already open, without a lock. */
+	inode = inode_lookup (sector);
+	if (inode != NULL)
+		return inode;
+
+	/* Look again under the lock, since someone else may have opened
+	 * it in the meantime. */
+	lock_acquire (&open_inodes_lock);
+	inode = inode_lookup (sector);
+	if (inode == NULL) {
+		/* Allocate memory. */
+		inode = kmem_cache_alloc (inode_cache);
+		if (inode != NULL) {
+			/* Initialize, then publish. */
+			inode->sector = sector;
+			inode->open_cnt = 1;
+			inode->deny_write_cnt = 0;
+			inode->removed = false;
+			disk_read (filesys_disk, inode->sector, &inode->data);
+			rcu_list_insert (list_begin (&open_inodes), &inode->elem);
+		}
+	}
+	lock_release (&open_inodes_lock);
+	return inode;
+}
+
+/* Returns the open inode for SECTOR with a new reference taken,
+ * or a null pointer if there is none. */
+static struct inode *
+inode_lookup (disk_sector_t sector) {
+	struct list_elem *e;
+	struct inode *found = NULL;
+
+	rcu_read_lock ();
 	for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
 			e = list_next (e)) {
-		inode = list_entry (e, struct inode, elem);
-		if (inode->sector == sector) {
-			inode_reopen (inode);
-			return inode; 
+		struct inode *inode = list_entry (e, struct inode, elem);
+		if (inode->sector == sector && inode_get (inode)) {
+			found = inode;
+			break;
 		}
 	}
+	rcu_read_unlock ();
+	return found;
+}
 
-	/* Allocate memory. */
-	inode = malloc (sizeof *inode);
-	if (inode == NULL)
-		return NULL;
-
-	/* Initialize. */
-	list_push_front (&open_inodes, &inode->elem);
-	inode->sector = sector;
-	inode->open_cnt = 1;
-	inode->deny_write_cnt = 0;
-	inode->removed = false;
-	disk_read (filesys_disk, inode->sector, &inode->data);
-	return inode;
+/* Takes a reference to INODE unless its last opener has already
+ * closed it, in which case it is about to leave the list. */
+static bool
+inode_get (struct inode *inode) {
+	enum intr_level old_level = intr_disable ();
+	bool alive = inode->open_cnt > 0;
+
+	if (alive)
+		inode->open_cnt++;
+	intr_set_level (old_level);
+	return alive;
 }
 
 /* Reopens and returns INODE. */
 struct inode *
 inode_reopen (struct inode *inode) {
-	if (inode != NULL)
+	if (inode != NULL) {
+		enum intr_level old_level = intr_disable ();
 		inode->open_cnt++;
+		intr_set_level (old_level);
+	}
 	return inode;
 }
 
@@ -148,14 +204,24 @@ inode_get_inumber (const struct inode *inode) {
  * If INODE was also a removed inode, frees its blocks. */
 void
 inode_close (struct inode *inode) {
+	enum intr_level old_level;
+	bool last;
+
 	/* Ignore null pointer. */
 	if (inode == NULL)
 		return;
 
+	old_level = intr_disable ();
+	last = --inode->open_cnt == 0;
+	intr_set_level (old_level);
+
 	/* Release resources if this was the last opener. */
-	if (--inode->open_cnt == 0) {
-		/* Remove from inode list and release lock. */
+	if (last) {
+		/* Remove from inode list.  Lookups that are still walking
+		 * past INODE keep it alive until the grace period ends. */
+		lock_acquire (&open_inodes_lock);
 		list_remove (&inode->elem);
+		lock_release (&open_inodes_lock);
 
 		/* Deallocate blocks if removed. */
 		if (inode->removed) {
@@ -164,10 +230,16 @@ inode_close (struct inode *inode) {
 					bytes_to_sectors (inode->data.length)); 
 		}
 
-		free (inode); 
+		call_rcu (&inode->rcu, inode_free);
 	}
 }
 
+/* Frees an inode once no lookup can still see it. */
+static void
+inode_free (struct rcu_head *head) {
+	kmem_cache_free (inode_cache, rcu_entry (head, struct inode, rcu));
+}
+
 /* Marks INODE to be deleted when it is closed by the last caller who
  * has it open. */
 void
@@ -2,11 +2,15 @@
 #define DEVICES_TIMER_H
 
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/* -tickless: idle일 때 dynamic tick 사용 */
+extern bool timer_tickless;
+
 void timer_init (void);
 void timer_calibrate (void);
 
@@ -18,6 +22,10 @@ void timer_msleep (int64_t milliseconds);
 void timer_usleep (int64_t microseconds);
 void timer_nsleep (int64_t nanoseconds);
 
+void timer_idle_enter (void);
+void timer_idle_exit (void);
+
+uint64_t timer_intr_cycles (void);
 void timer_print_stats (void);
 
 #endif /* devices/timer.h */
@@ -119,6 +119,60 @@ static __inline uint64_t rcr2(void) {
 	return val;
 }
 
+__attribute__((always_inline))
+static __inline uint64_t rcr0(void) {
+	uint64_t val;
+	__asm __volatile("movq %%cr0,%0" : "=r" (val));
+	return val;
+}
+
+__attribute__((always_inline))
+static __inline void lcr0(uint64_t val) {
+	__asm __volatile("movq %0, %%cr0" : : "r" (val));
+}
+
+__attribute__((always_inline))
+static __inline uint64_t rcr4(void) {
+	uint64_t val;
+	__asm __volatile("movq %%cr4,%0" : "=r" (val));
+	return val;
+}
+
+__attribute__((always_inline))
+static __inline void lcr4(uint64_t val) {
+	__asm __volatile("movq %0, %%cr4" : : "r" (val));
+}
+
+/* Clears CR0.TS.  See [IA32-v2a] "CLTS". */
+__attribute__((always_inline))
+static __inline void clts(void) {
+	__asm __volatile("clts");
+}
+
+/* Executes CPUID with EAX = LEAF and ECX = SUBLEAF. */
+__attribute__((always_inline))
+static __inline void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t *eax,
+		uint32_t *ebx, uint32_t *ecx, uint32_t *edx) {
+	__asm __volatile("cpuid"
+			: "=a" (*eax), "=b" (*ebx), "=c" (*ecx), "=d" (*edx)
+			: "a" (leaf), "c" (subleaf));
+}
+
+/* Writes extended control register XCR.  See [IA32-v2b] "XSETBV". */
+__attribute__((always_inline))
+static __inline void xsetbv(uint32_t xcr, uint64_t val) {
+	__asm __volatile("xsetbv"
+			:: "c" (xcr), "d" ((uint32_t) (val >> 32)), "a" ((uint32_t) val));
+}
+
+/* Reads the time-stamp counter.  See [IA32-v2b] "RDTSC". */
+__attribute__((always_inline))
+static __inline uint64_t rdtsc(void) {
+	uint32_t lo, hi;
+	__asm __volatile("rdtsc" : "=a" (lo), "=d" (hi));
+	return ((uint64_t) hi << 32) | lo;
+}
+
 __attribute__((always_inline))
 static __inline void write_msr(uint32_t ecx, uint64_t val) {
 	uint32_t edx, eax;
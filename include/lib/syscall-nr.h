@@ -36,6 +36,16 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Scheduling statistics. */
+	SYS_THREADSTATS,            /* Obtain the calling thread's statistics. */
+
+	/* User threads. */
+	SYS_CLONE,                  /* Start a thread in this process. */
+	SYS_THREAD_JOIN,            /* Wait for a thread to exit. */
+	SYS_THREAD_EXIT,            /* Terminate the calling thread. */
+	SYS_FUTEX_WAIT,             /* Sleep while a word holds a value. */
+	SYS_FUTEX_WAKE,             /* Wake threads sleeping on a word. */
 };
 
 #endif /* lib/syscall-nr.h */
@@ -0,0 +1,20 @@
+#ifndef __LIB_THREAD_STATS_H
+#define __LIB_THREAD_STATS_H
+
+#include <stdint.h>
+
+/* Per-thread scheduling statistics.
+   Shared by the kernel and user programs (SYS_THREADSTATS). */
+struct thread_stats {
+	uint64_t run_cycles;            /* Time spent running, in TSC cycles. */
+	uint64_t ready_cycles;          /* Time spent waiting on a run queue. */
+	uint64_t lock_cycles;           /* Time spent blocked in lock_acquire(). */
+	int64_t run_ticks;              /* Timer ticks taken while running. */
+	unsigned voluntary_switches;    /* Switches away by blocking or exiting. */
+	unsigned involuntary_switches;  /* Switches away while still runnable. */
+	unsigned donations;             /* Priority donations received. */
+	unsigned slices;                /* Time slices handed out. */
+	uint64_t slice_ticks;           /* Sum of their lengths, in ticks. */
+};
+
+#endif /* lib/thread-stats.h */
@@ -4,11 +4,16 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <thread-stats.h>
 
 /* Process identifier. */
 typedef int pid_t;
 #define PID_ERROR ((pid_t) -1)
 
+/* Thread identifier. */
+typedef int tid_t;
+#define TID_ERROR ((tid_t) -1)
+
 /* Map region identifier. */
 typedef int off_t;
 #define MAP_FAILED ((void *) NULL)
@@ -38,6 +43,17 @@ void close (int fd);
 
 int dup2(int oldfd, int newfd);
 
+/* Scheduling statistics. */
+bool threadstats (struct thread_stats *stats);
+
+/* Threads sharing this process's address space and open files.
+   See <uthread.h> for a friendlier interface. */
+tid_t clone (void (*entry) (void *), void *arg, void *stack);
+int thread_join (tid_t);
+void thread_exit (int status) NO_RETURN;
+int futex_wait (int *addr, int expected);
+int futex_wake (int *addr, int cnt);
+
 /* Project 3 and optionally project 4. */
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap (void *addr);
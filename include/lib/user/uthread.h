@@ -0,0 +1,57 @@
+#ifndef __LIB_USER_UTHREAD_H
+#define __LIB_USER_UTHREAD_H
+
+#include <syscall.h>
+
+/* User-level threads on top of clone().
+
+   Every thread of a process shares its memory and open files.
+   Stacks come from a fixed pool of UTHREAD_MAX slots, so at most
+   that many threads created here may be alive, or exited but not
+   yet joined, at once.  A thread's slot is recycled when it is
+   joined.
+
+   Returning from a thread function is the same as calling
+   uthread_exit() with its return value, which ends only that
+   thread.  exit() from any thread, returning from main(), or a
+   fault in any thread ends every thread of the process. */
+
+#define UTHREAD_MAX 8                   /* Threads per process. */
+#define UTHREAD_STACK_SIZE (2 * 4096)   /* Bytes of stack per thread. */
+
+typedef int uthread_func (void *aux);
+
+tid_t uthread_create (uthread_func *, void *aux);
+int uthread_join (tid_t);
+void uthread_exit (int status) NO_RETURN;
+
+/* Mutex built on futex_wait() and futex_wake().  Locking and
+   unlocking an uncontended mutex never enters the kernel. */
+struct uthread_mutex
+  {
+    int state;                  /* 0: unlocked, 1: locked,
+                                   2: locked, maybe with waiters. */
+    unsigned contended;         /* Acquisitions that had to wait. */
+  };
+
+#define UTHREAD_MUTEX_INITIALIZER { 0, 0 }
+
+void uthread_mutex_init (struct uthread_mutex *);
+void uthread_mutex_lock (struct uthread_mutex *);
+bool uthread_mutex_trylock (struct uthread_mutex *);
+void uthread_mutex_unlock (struct uthread_mutex *);
+
+/* Condition variable for use with a uthread_mutex. */
+struct uthread_cond
+  {
+    int seq;                    /* Bumped by every signal. */
+  };
+
+#define UTHREAD_COND_INITIALIZER { 0 }
+
+void uthread_cond_init (struct uthread_cond *);
+void uthread_cond_wait (struct uthread_cond *, struct uthread_mutex *);
+void uthread_cond_signal (struct uthread_cond *);
+void uthread_cond_broadcast (struct uthread_cond *);
+
+#endif /* lib/user/uthread.h */
@@ -0,0 +1,79 @@
+#ifndef THREADS_FIXED_POINT_H
+#define THREADS_FIXED_POINT_H
+
+#include <stdint.h>
+
+/* MLFQS에서 쓰는 17.14 고정소수점 연산.
+   커널은 -msoft-float로 빌드되므로 recent_cpu, load_avg 같은
+   실수 값은 정수 하위 14비트를 소수부로 써서 표현한다. */
+
+typedef int fixed_t;
+
+#define FP_SHIFT 14                 /* 소수부 비트 수 */
+#define FP_F (1 << FP_SHIFT)        /* 1.0 */
+
+/* 정수 N을 고정소수점으로 */
+static inline fixed_t
+fp_from_int (int n) {
+	return n * FP_F;
+}
+
+/* X를 0 방향으로 버려서 정수로 */
+static inline int
+fp_to_int (fixed_t x) {
+	return x / FP_F;
+}
+
+/* X를 가장 가까운 정수로 반올림 */
+static inline int
+fp_round (fixed_t x) {
+	return x >= 0 ? (x + FP_F / 2) / FP_F : (x - FP_F / 2) / FP_F;
+}
+
+static inline fixed_t
+fp_add (fixed_t x, fixed_t y) {
+	return x + y;
+}
+
+static inline fixed_t
+fp_sub (fixed_t x, fixed_t y) {
+	return x - y;
+}
+
+/* X + N (N은 정수) */
+static inline fixed_t
+fp_add_int (fixed_t x, int n) {
+	return x + n * FP_F;
+}
+
+/* X - N (N은 정수) */
+static inline fixed_t
+fp_sub_int (fixed_t x, int n) {
+	return x - n * FP_F;
+}
+
+/* X * Y, 중간값이 넘치지 않도록 64비트로 계산 */
+static inline fixed_t
+fp_mul (fixed_t x, fixed_t y) {
+	return ((int64_t) x) * y / FP_F;
+}
+
+/* X * N (N은 정수) */
+static inline fixed_t
+fp_mul_int (fixed_t x, int n) {
+	return x * n;
+}
+
+/* X / Y */
+static inline fixed_t
+fp_div (fixed_t x, fixed_t y) {
+	return ((int64_t) x) * FP_F / y;
+}
+
+/* X / N (N은 정수) */
+static inline fixed_t
+fp_div_int (fixed_t x, int n) {
+	return x / n;
+}
+
+#endif /* threads/fixed_point.h */
@@ -0,0 +1,15 @@
+#ifndef THREADS_FPU_H
+#define THREADS_FPU_H
+
+#include <stdbool.h>
+
+struct thread;
+
+void fpu_init (void);
+void fpu_switch (struct thread *next);
+void fpu_exit (struct thread *);
+bool fpu_fork (struct thread *dst, struct thread *src);
+void fpu_release (struct thread *);
+void fpu_print_stats (void);
+
+#endif /* threads/fpu.h */
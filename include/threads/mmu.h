@@ -8,6 +8,7 @@
 typedef bool pte_for_each_func (uint64_t *pte, void *va, void *aux);
 
 uint64_t *pml4e_walk (uint64_t *pml4, const uint64_t va, int create);
+uint64_t *pml4_pde_walk (uint64_t *pml4, const uint64_t va, int create);
 uint64_t *pml4_create (void);
 bool pml4_for_each (uint64_t *, pte_for_each_func *, void *);
 void pml4_destroy (uint64_t *pml4);
@@ -23,6 +24,7 @@ void pml4_set_accessed (uint64_t *pml4, const void *upage, bool accessed);
 #define is_writable(pte) (*(pte) & PTE_W)
 #define is_user_pte(pte) (*(pte) & PTE_U)
 #define is_kern_pte(pte) (!is_user_pte (pte))
+#define is_large_pte(pte) (*(pte) & PTE_PS)
 
 #define pte_get_paddr(pte) (pg_round_down(*(pte)))
 
@@ -0,0 +1,50 @@
+#ifndef THREADS_RCU_H
+#define THREADS_RCU_H
+
+#include <list.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/synch.h"
+
+/* Read-copy update (epoch 기반).
+
+   자주 찾고 가끔 바뀌는 자료구조를 위한 것.  reader는 rcu_read_lock()과
+   rcu_read_unlock() 사이에서 lock 없이 자료구조를 훑는다.  writer는 writer
+   끼리만 lock으로 막고, 원소를 새 버전으로 바꾸거나 빼낸 뒤 옛 원소는
+   바로 해제하지 않고 call_rcu()에 넘긴다.  그때 read-side 안에 있던
+   reader가 모두 나가면 (grace period) 넘긴 함수가 불려 해제한다.
+
+   read-side 진입 때 현재 epoch를 기록하고 epoch별 reader 수를 센다.
+   schedule()이 문맥 교환 때마다 이전 epoch의 reader가 모두 나갔는지 보고
+   그렇다면 epoch를 넘기는데, 그러면 두 epoch 전에 들어온 callback은
+   안전하다.  callback은 "rcu" workqueue에서 실행되므로 잠들어도 된다.
+
+   read-side 안에서는 잠들 수 있지만 (선점, lock 대기) 그동안 grace period가
+   끝나지 않으므로 짧게 머물러야 한다.  중첩할 수 있다. */
+
+/* call_rcu()에 넘기는 원소.  해제할 구조체 안에 둔다. */
+struct rcu_head {
+	struct list_elem elem;
+	void (*func) (struct rcu_head *);
+};
+
+/* HEAD를 담고 있는 STRUCT의 포인터.  list_entry()와 같다. */
+#define rcu_entry(HEAD, STRUCT, MEMBER) \
+	((STRUCT *) ((uint8_t *) (HEAD) - offsetof (STRUCT, MEMBER)))
+
+/* reader가 P를 한 번만 읽게 한다. */
+#define rcu_dereference(P) (*(volatile __typeof__ (P) *) &(P))
+
+/* 새 버전 V를 다 채운 뒤에 P에 건다. */
+#define rcu_assign_pointer(P, V) \
+	do { barrier (); (P) = (V); } while (0)
+
+void rcu_init (void);
+void rcu_read_lock (void);
+void rcu_read_unlock (void);
+void call_rcu (struct rcu_head *, void (*func) (struct rcu_head *));
+void rcu_synchronize (void);
+void rcu_quiescent (void);
+void rcu_list_insert (struct list_elem *before, struct list_elem *elem);
+
+#endif /* threads/rcu.h */
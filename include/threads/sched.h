@@ -0,0 +1,84 @@
+#ifndef THREADS_SCHED_H
+#define THREADS_SCHED_H
+
+#include <list.h>
+#include <rbtree.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "threads/thread.h"
+
+/* Scheduler classes.
+
+   ready 스레드를 어떻게 담고 다음에 누구를 실행할지는 scheduler class가
+   정한다.  thread.c는 run queue의 스레드 수만 관리하고
+   나머지는 모두 현재 class(sched_class)의 함수를 부른다.
+   커널 옵션 -sched=NAME으로 고르며 기본은 priority.
+
+   - priority: 우선순위별 FIFO + bitmap.  가장 높은 우선순위를 라운드 로빈.
+     -mlfqs는 이 class 위에서 우선순위를 계산한다.
+   - cfs: 우선순위에서 나온 weight로 나눈 실행 시간(vruntime)이 가장 작은
+     스레드를 실행한다.  vruntime 순서의 red-black tree.
+   - stride: weight만큼의 ticket을 가진 stride scheduling.
+     매 tick pass += stride, pass가 가장 작은 스레드를 실행한다. */
+
+#define TIME_SLICE 4            /* # of timer ticks to give each thread. */
+
+/* Adaptive time slice.
+   스레드마다 time slice 길이(t->slice)를 따로 두고
+   [sched_slice_min, sched_slice_max] 안에서 행동에 맞춰 조절한다.
+   slice를 다 쓰기 전에 block하면 1 tick 줄이고, 다 써서 선점되면
+   두 배로 늘린다.  I/O 위주 스레드는 짧은 slice를 받는 대신 깨어날 때
+   같은 우선순위의 앞에 서고, CPU 위주 스레드는 긴 slice로 문맥 교환이
+   줄어든다.  -slice-min=N, -slice-max=N으로 정하며 기본은 둘 다
+   TIME_SLICE라서 모든 스레드가 고정된 TIME_SLICE를 받는다. */
+extern unsigned sched_slice_min;
+extern unsigned sched_slice_max;
+
+/* ready 스레드들을 담는 run queue.  필드는 class별로 나뉜다. */
+#if PRI_MAX - PRI_MIN + 1 > 64
+#error ready bitmap holds at most 64 priority levels
+#endif
+struct runqueue {
+	int cnt;                    /* 들어있는 스레드 수 */
+
+	/* priority: queue[i]는 priority가 i인 스레드들의 FIFO,
+	   bitmap의 i번째 비트는 queue[i]가 비어있지 않다는 뜻 */
+	struct list queue[PRI_MAX + 1];
+	uint64_t bitmap;
+
+	/* cfs, stride: sched_key (vruntime, pass) 순서의 tree */
+	struct rb_tree tree;
+	uint64_t min_key;           /* 지금까지 실행된 sched_key의 최댓값, 단조 증가 */
+};
+
+/* Scheduler class.  모든 함수는 인터럽트가 꺼진 채로 불린다
+   (init은 thread_init()에서). */
+struct sched_class {
+	const char *name;
+
+	/* RQ를 빈 상태로 초기화 */
+	void (*init) (struct runqueue *rq);
+
+	/* ready가 된 T를 RQ에 넣는다. */
+	void (*enqueue) (struct runqueue *rq, struct thread *t);
+
+	/* ready인 T를 RQ에서 뺀다 (우선순위가 바뀌어 다시 넣을 때). */
+	void (*dequeue) (struct runqueue *rq, struct thread *t);
+
+	/* 다음에 실행할 스레드를 RQ에서 꺼낸다.  비어있으면 NULL. */
+	struct thread *(*pick_next) (struct runqueue *rq);
+
+	/* 실행 중인 CURR가 이번 time slice에서 TICKS번째 tick을 썼다.
+	   CURR를 선점해야 하면 true. */
+	bool (*tick) (struct runqueue *rq, struct thread *curr, unsigned ticks);
+};
+
+extern const struct sched_class *sched_class;
+extern const struct sched_class sched_priority;
+
+bool sched_select (const char *name);
+int sched_weight (int priority);
+unsigned sched_slice_init (void);
+void sched_slice_adapt (struct thread *, unsigned used, bool blocked);
+
+#endif /* threads/sched.h */
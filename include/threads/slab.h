@@ -0,0 +1,28 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <stddef.h>
+
+/* 크기가 정해진 커널 객체를 위한 slab 할당자.
+
+   객체 종류마다 kmem_cache를 하나 만들고 거기서 할당, 해제한다.
+   cache는 페이지 하나를 slab으로 잘라 같은 크기의 객체를 빈틈 없이
+   담으므로 malloc()처럼 2의 거듭제곱으로 올려 낭비하지 않고, lock도
+   cache마다 따로 있다.  완전히 빈 slab 페이지는 cache끼리 돌려 쓴다.
+
+   CTOR를 주면 slab을 만들 때 객체마다 한 번 부른다.  그 뒤로 객체는
+   생성된 상태로 나가고 들어오며, 해제 전에 그 상태로 되돌려 놓는 것은
+   쓰는 쪽의 몫이다.  CTOR가 없으면 kmem_cache_alloc()이 주는 객체의
+   내용은 정해져 있지 않다. */
+
+struct kmem_cache;
+typedef void kmem_ctor_func (void *obj);
+
+void kmem_init (void);
+struct kmem_cache *kmem_cache_create (const char *name, size_t size,
+		kmem_ctor_func *ctor);
+void *kmem_cache_alloc (struct kmem_cache *);
+void kmem_cache_free (struct kmem_cache *, void *obj);
+void kmem_print_stats (void);
+
+#endif /* threads/slab.h */
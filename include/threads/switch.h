@@ -0,0 +1,27 @@
+#ifndef THREADS_SWITCH_H
+#define THREADS_SWITCH_H
+
+#include <stdint.h>
+
+/* Stack frame pushed by switch_threads(), lowest address first.
+   thread_create() builds one by hand so that the first switch
+   to a new thread "returns" to switch_entry(). */
+struct switch_frame {
+	uint64_t r15;
+	uint64_t r14;
+	uint64_t r13;                   /* New thread: kernel_thread(). */
+	uint64_t r12;                   /* New thread: its aux argument. */
+	uint64_t rbp;
+	uint64_t rbx;                   /* New thread: its function. */
+	void (*rip) (void);             /* Return address. */
+};
+
+/* Saves the running thread's callee-saved registers and stack
+   pointer into *CUR_RSP and resumes the thread whose stack
+   pointer is NEXT_RSP. */
+void switch_threads (uint64_t *cur_rsp, uint64_t next_rsp);
+
+/* Entry point of a newly created thread. */
+void switch_entry (void);
+
+#endif /* threads/switch.h */
@@ -1,43 +1,124 @@
 #ifndef THREADS_SYNCH_H
 #define THREADS_SYNCH_H
 
+#include <debug.h>
 #include <list.h>
+#include <rbtree.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 /* A counting semaphore. */
 struct semaphore {
-	unsigned value;        /* 현재 세마포어 값 */
-	struct list waiters;   /* 세마포어를 기다리는 스레드 목록을 관리하기 위한 연결 리스트, 세마포어를 기다리며 차단된 스레드들이 들어감 */
+	unsigned value;          /* 현재 세마포어 값 */
+	struct rb_tree waiters;  /* 기다리는 스레드들 (wait_elem), 우선순위가 높은 순, 같으면 온 순서 */
 };
 
 void sema_init (struct semaphore *, unsigned value);
 void sema_down (struct semaphore *);
+bool sema_down_timeout (struct semaphore *, int64_t ticks);
 bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
 void sema_self_test (void);
 
+/* 락이나 rwlock reader가 holder에게 넘긴 우선순위 하나.
+   넘겼으면 holder의 donations에 우선순위가 높은 순으로 들어있다. */
+struct donation {
+	int priority;               /* 넘긴 우선순위, 없으면 -1 */
+	struct rb_elem elem;        /* holder->donations 원소 */
+};
+
 /* Lock. */
 struct lock {
 	struct thread *holder;      /* 현재 락을 소유한 스레드 (for debugging). */
-	struct semaphore semaphore; /* 락을 구현하기 위해 이진 세마포어를 활용한 구조체 */
+	struct semaphore semaphore; /* 락을 구현하기 위해 이진 세마포어를 활용한 구조체.
+	                               waiters의 맨 앞이 최고 waiter 우선순위 */
+	struct donation donation;   /* holder에게 넘긴 최고 waiter 우선순위 */
+#ifdef LOCKSTAT
+	struct lock_class *class;   /* 통계를 모으는 class, 표가 꽉 찼으면 NULL */
+	uint64_t acquired_at;       /* holder가 잡은 시각 (TSC) */
+#endif
 };
 
 void lock_init (struct lock *);
 void lock_acquire (struct lock *);
+bool lock_acquire_timeout (struct lock *, int64_t ticks);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
 
+/* Lock contention statistics.
+   `make LOCKSTAT=1'로 빌드하면 (-DLOCKSTAT, 바꿀 때는 make clean) 락마다
+   획득 횟수, 기다린 횟수, 기다린 시간과 잡고 있던 시간의 합과 최댓값을
+   TSC cycle 단위로 모은다.  통계는 class 단위로 모이는데, 기본 class는
+   lock_init()을 부른 곳 (주소)이라 같은 곳에서 만든 락은 합쳐진다.
+   lock_set_name()으로 이름을 붙인 락은 그 이름의 class를 따로 가진다.
+   power off 때와 `lockstat' action으로 기다린 시간 순으로 출력한다.
+   LOCKSTAT 없이 빌드하면 lock_set_name()은 아무 코드도 만들지 않는다.
+   락 대신 인터럽트를 꺼서 보호하는 자료구조 (palloc의 pool, run queue,
+   futex bucket 등)는 기다리는 스레드가 없으므로 여기에 나오지 않는다.
+   그 비용은 인터럽트를 끈 시간이라 wakeup latency 통계에 드러난다. */
+#ifdef LOCKSTAT
+struct lock_class {
+	char name[24];              /* lock_set_name()의 이름, 없으면 "" */
+	void *site;                 /* 이름이 없으면 lock_init()을 부른 주소 */
+	long long acquired;         /* 획득 횟수 */
+	long long contended;        /* 그중 holder가 있어 기다린 횟수 */
+	uint64_t wait_total, wait_max;
+	uint64_t hold_total, hold_max;
+};
+
+void lock_set_name (struct lock *, const char *format, ...)
+	PRINTF_FORMAT (2, 3);
+void lockstat_print (void);
+#else
+#define lock_set_name(LOCK, ...) ((void) 0)
+#endif
+
+/* Reader-writer lock.
+   reader 여럿이 함께 잡거나 writer 하나가 잡는다.  writer는 LOCK을 잡은 채로
+   쓰고, reader는 들어올 때만 LOCK을 잠깐 잡으므로 writer가 기다리기 시작하면
+   뒤에 온 reader들은 LOCK에서 막힌다 (writer 우선).  LOCK의 waiter들은
+   우선순위, 같으면 온 순서로 깨어나므로 reader와 writer 모두 굶지 않는다.
+   LOCK에서 기다리는 스레드는 보통의 락처럼 holder에게, reader들이 나가기를
+   기다리는 writer는 읽고 있는 모든 reader에게 우선순위를 donation한다.
+   같은 스레드가 읽기로 겹쳐 잡을 수 있고 (잡은 횟수만큼 놓는다), 읽기로 잡을
+   수 있는 rwlock 수에 제한은 없다.  읽기로 잡은 채로 쓰기로 잡을 수는 없다. */
+struct rwlock {
+	struct lock lock;           /* writer가 쓰는 동안, reader는 들어올 때만 잡는다 */
+	int readers;                /* 읽고 있는 스레드 수 */
+	struct list reader_list;    /* 읽고 있는 스레드들의 rw_reader */
+	bool draining;              /* LOCK을 잡은 writer가 reader들이 나가기를 기다리는 중 */
+	struct semaphore drained;   /* DRAINING일 때 마지막 reader가 up */
+};
+
+/* 스레드가 읽기로 잡고 있는 rwlock 하나.  처음 것은 struct thread의
+   rw_read에, 동시에 둘 이상 잡으면 나머지는 malloc()으로 만든다. */
+struct rw_reader {
+	struct rwlock *rw;          /* 잡고 있는 rwlock, 빈 칸이면 NULL */
+	struct thread *thread;      /* 잡고 있는 스레드 */
+	int depth;                  /* 겹쳐 잡은 횟수 */
+	struct donation donation;   /* thread에게 넘긴 writer의 우선순위 */
+	struct list_elem elem;      /* rw->reader_list 원소 */
+	struct list_elem thread_elem; /* thread->rw_reads 원소 */
+};
+
+void rw_init (struct rwlock *);
+void rw_read_acquire (struct rwlock *);
+void rw_read_release (struct rwlock *);
+void rw_write_acquire (struct rwlock *);
+void rw_write_release (struct rwlock *);
+void rw_donate_readers (struct rwlock *);
+
 /* Condition variable. */
 struct condition {
-	struct list waiters;        /* List of waiting threads. */
+	struct rb_tree waiters;     /* 기다리는 스레드들 (wait_elem), semaphore와 같은 순서 */
 };
 
 void cond_init (struct condition *);
 void cond_wait (struct condition *, struct lock *);
+bool cond_wait_timeout (struct condition *, struct lock *, int64_t ticks);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
-bool cond_compare_priority (const struct list_elem *a, const struct list_elem *b, void *aux);
 
 /* 최적화 장벽
  *
@@ -4,8 +4,11 @@
 
 #include <debug.h>
 #include <list.h>
+#include <rbtree.h>
 #include <stdint.h>
+#include <thread-stats.h>
 #include "threads/interrupt.h"
+#include "threads/fixed_point.h"
 #include "synch.h"
 #ifdef VM
 #include "vm/vm.h"
@@ -29,6 +32,11 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+/* Thread niceness (MLFQS). */
+#define NICE_MIN -20                    /* Nicest to others. */
+#define NICE_DEFAULT 0                  /* Default niceness. */
+#define NICE_MAX 20                     /* Least nice. */
+
 /* A kernel thread or user process.
  *
  * Each thread structure is stored in its own 4 kB page.  The
@@ -106,17 +114,41 @@ struct thread {
 	/* Shared between thread.c and synch.c. */
 	// alam
 	int64_t end_tick;					/* End tick: alarm 할 때 쓴 거 */
+	bool sleeping;						/* timing wheel에 들어있음 (elem) */
+	bool timed_out;						/* thread_block_until()이 END_TICK이 되어 깨어남 */
 
 	// priority schedule
-	struct list donation_list;			/* 나한테 기부해준 스레드 담을 리스트 */
+	struct rb_tree donations;			/* 들고 있는 락들이 받은 struct donation, 높은 순 */
 	struct lock *want_lock;				/* 해당 스레드가 원하는 lock이 뭔지 알아야 함 */
-	struct list_elem d_elem;			/* donation_list init될 때 사용되는 elem */
+	struct rwlock *drain_rw;			/* 이 rwlock의 reader들이 나가기를 기다리는 중 */
+	struct rw_reader rw_read;			/* 읽기로 잡은 rwlock 기록 하나 (threads/synch.c) */
+	struct list rw_reads;				/* 읽기로 잡고 있는 rwlock들의 rw_reader */
+	struct rb_tree *wait_tree;			/* 기다리는 semaphore/condition의 waiters, 없으면 NULL */
+	struct rb_elem wait_elem;			/* WAIT_TREE의 원소 (threads/synch.c) */
+	int rcu_nesting;					/* rcu_read_lock() 중첩 깊이 */
+	unsigned rcu_epoch;					/* read-side에 들어갈 때의 epoch (threads/rcu.c) */
 	struct list_elem elem;              /* ready list가 init될 때 사용되는 elem */
+	struct rb_elem sched_elem;			/* cfs, stride class의 run queue tree 원소 */
+	uint64_t sched_key;					/* cfs: vruntime, stride: pass (threads/sched.c) */
+	unsigned slice;						/* time slice 길이 (tick), sched_slice_adapt() */
+
+	// lazy FPU
+	void *fpu_area;						/* XSAVE 영역, FPU를 처음 쓸 때 할당 (threads/fpu.c) */
+
+	// 스케줄링 통계
+	struct thread_stats stats;
+	uint64_t stats_stamp;				/* 지금 상태(running/ready/blocked)가 시작된 TSC */
+	uint64_t wake_stamp;				/* thread_unblock()된 TSC, CPU를 받으면 0 */
+	tid_t waker;						/* unblock할 때 실행 중이던 스레드 */
 	struct thread* parent;
 
+	// mlfqs
+	int nice;							/* 다른 스레드에게 얼마나 양보할지 (NICE_MIN ~ NICE_MAX) */
+	fixed_t recent_cpu;					/* 최근에 CPU를 얼마나 썼는지 (고정소수점) */
+	struct list_elem all_elem;			/* all_list에 들어가는 elem, 1초마다 recent_cpu 감쇠에 사용 */
+
 	// syscall
 	struct file **fd_table;				/* 파일의 배열 */
-	int fd_cnt;							/* 한 프로세스 당 몇개의 파일이 열려있는지 카운트 */
 
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
@@ -126,6 +158,10 @@ struct thread {
 	struct semaphore fork_sema;			/* 자식 프로세스의 복제 대기 */
 	struct semaphore wait_sema;			/* 자식 프로세스의 생성 대기 */
 	struct intr_frame parent_if;		/* 부모 프로세스의 intr_frame 을 저장 */
+	struct proc_group *group;			/* 같은 pml4, fd table을 쓰는 스레드 묶음 */
+	struct uthread_info *uthread;		/* clone()으로 만든 스레드의 종료 정보, leader는 NULL */
+	struct list_elem group_elem;		/* group->members 원소 */
+	bool killed;						/* 다른 스레드가 프로세스를 끝냄, 유저 모드로 돌아가지 않는다 */
     uint64_t *pml4;                     /* Page map level 4 */
 #endif
 #ifdef VM
@@ -134,7 +170,7 @@ struct thread {
 #endif
 
     /* Owned by thread.c. */
-    struct intr_frame tf;               /* Information for switching */
+    uint64_t rsp;                       /* Saved kernel stack pointer (threads/switch.S) */
     unsigned magic;                     /* Detects stack overflow. */
 };
 
@@ -143,27 +179,35 @@ struct thread {
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, the idle thread zeroes recycled thread pages.
+   Controlled by kernel command-line option "-zero-threads". */
+extern bool thread_zero_pages;
+
 void thread_init (void);
 void thread_start (void);
 
 void thread_tick (void);
+void thread_tick_idle (int64_t cnt);
 void thread_print_stats (void);
+void thread_print_top (void);
+void thread_print_latency (void);
+void thread_get_stats (struct thread *, struct thread_stats *);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
 
 void thread_sleep(int64_t wake_time);
+bool thread_block_until (int64_t wake_time);
 void thread_wake(int64_t now_ticks);
+int64_t thread_wake_deadline (int64_t limit);
 void thread_block (void);
 void thread_unblock (struct thread *);
-bool compare_ticks(struct list_elem *me, struct list_elem *you, void *aux);
-bool compare_priority(struct list_elem *me, struct list_elem *you, void *aux);
 
 /* donation시 필요한 함수 */
-bool donate_compare_priority(struct list_elem *me, struct list_elem *you, void *aux);
-void donation_priority(void);
-void remove_thread_in_donation_list (struct lock *lock);
+void donation_priority(struct lock *lock);
+void donation_update (struct thread *holder, struct donation *, int top);
 void reset_priority(void);
+void thread_change_priority (struct thread *t, int priority);
 
 struct thread *thread_current (void);
 tid_t thread_tid (void);
@@ -0,0 +1,63 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "threads/synch.h"
+
+/* Workqueue.
+
+   인터럽트 핸들러나 다른 스레드가 할 일(work)을 넣어두면 workqueue의
+   worker 스레드가 꺼내서 실행한다.  writeback, swap-out 같은 백그라운드
+   작업이 각자 커널 스레드를 만들지 않고 여기서 실행되도록 하기 위한 것.
+
+   worker는 일이 밀릴 때 max_workers까지 늘어나고, 할 일이 없으면
+   하나만 남기고 종료한다.  wq_queue()와 wq_queue_delayed()는 인터럽트
+   핸들러에서도 부를 수 있지만, 인터럽트에서는 worker를 새로 만들 수
+   없으므로 바쁜 worker가 끝날 때까지 기다릴 수 있다.
+
+   struct work는 호출자가 가지고 있는 메모리에 두고 (동적 할당 없음)
+   처음 쓰기 전에 work_init()으로 초기화한다.  실행 직전에 pending이
+   풀리므로 work 함수 안에서 자기 자신을 다시 넣거나 해제해도 된다. */
+
+typedef void work_func (void *aux);
+
+/* 할 일 하나. */
+struct work {
+	struct list_elem elem;      /* workqueue의 queue 또는 delayed 리스트 원소 */
+	work_func *func;            /* 실행할 함수 */
+	void *aux;                  /* FUNC에 넘길 인자 */
+	int64_t due;                /* delayed work: 실행할 timer tick */
+	bool pending;               /* queue나 delayed 리스트에 들어있는지 */
+	struct workqueue *wq;       /* 넣은 workqueue */
+};
+
+/* Workqueue. */
+struct workqueue {
+	char name[16];              /* worker 스레드 이름 */
+	int priority;               /* worker 스레드 우선순위 */
+	int max_workers;            /* 최대 worker 수 */
+	int worker_cnt;             /* 살아있는 worker 수 */
+	int idle_cnt;               /* 일을 기다리는 worker 수 */
+	int running;                /* 실행 중인 work 수 */
+	int delayed_cnt;            /* 아직 때가 안 된 delayed work 수 */
+	int flush_waiters;          /* wq_flush()에서 기다리는 스레드 수 */
+	struct list queue;          /* 실행을 기다리는 work */
+	struct semaphore ready;     /* queue에 든 work 수 */
+	struct semaphore flushed;   /* 다 비면 flush_waiters만큼 up */
+	long long done_cnt;         /* 실행을 마친 work 수 */
+};
+
+void wq_init (void);
+void work_init (struct work *);
+struct workqueue *wq_create (const char *name, int priority, int max_workers);
+bool wq_queue (struct workqueue *, struct work *, work_func *, void *aux);
+bool wq_queue_delayed (struct workqueue *, struct work *, work_func *,
+		void *aux, int64_t ticks);
+void wq_flush (struct workqueue *);
+
+void wq_tick (int64_t now);
+int64_t wq_deadline (int64_t limit);
+
+#endif /* threads/workqueue.h */
@@ -0,0 +1,20 @@
+#ifndef USERPROG_FUTEX_H
+#define USERPROG_FUTEX_H
+
+#include <stdint.h>
+
+/* Futex.
+
+   유저 프로그램이 공유 메모리의 int 하나를 두고 잠들고 깨우는 syscall.
+   락이 비어있으면 유저 공간의 atomic 연산만으로 끝나고, 기다려야 할 때만
+   futex_wait()으로 커널에 들어온다 (lib/user/uthread.c의 mutex, condvar).
+
+   대기 큐는 주소의 물리 frame + offset으로 구분하므로 같은 frame을
+   공유하는 스레드들은 가상 주소가 달라도 같은 큐를 쓴다. */
+
+void futex_init (void);
+int futex_wait (int *uaddr, int expected);
+int futex_wake (int *uaddr, int cnt);
+void futex_wake_killed (void);
+
+#endif /* userprog/futex.h */
@@ -1,10 +1,47 @@
 #ifndef USERPROG_PROCESS_H
 #define USERPROG_PROCESS_H
 
+#include <list.h>
+#include "threads/synch.h"
 #include "threads/thread.h"
 
+/* 한 프로세스의 스레드들이 함께 쓰는 상태.
+   process_init()에서 만들고, clone()으로 만든 스레드는 만든 스레드의
+   pml4와 fd table을 그대로 쓰면서 이것을 공유한다.  refcnt는 pml4와
+   fd table을 쓰는 스레드 수로, 처음 스레드(leader)는 다른 스레드가 모두
+   나간 뒤에 마지막으로 나가면서 이것들을 해제한다.
+   어느 스레드든 exit()하거나 예외로 죽으면 프로세스 전체가 끝난다: 남은
+   스레드들에 killed를 표시하고 futex_wait()에서 깨우면, 그들은 유저 모드로
+   돌아가기 전에 스스로 나간다.  futex 말고 다른 곳에서 잠든 스레드는 그
+   기다림이 끝난 뒤에 나간다.  프로세스의 종료 상태는 처음 끝낸 스레드의
+   것이다.  thread_exit()은 clone한 스레드 하나만 끝낸다.
+   clone한 스레드의 종료나 join과 함께 인터럽트를 꺼서 보호한다. */
+struct proc_group {
+	int refcnt;                     /* pml4, fd table을 쓰는 스레드 수 */
+	int fd_cnt;                     /* fd table에서 쓴 가장 큰 fd */
+	struct list members;            /* 아직 나가지 않은 스레드들 (group_elem) */
+	struct list threads;            /* 아직 join되지 않은 uthread_info */
+	struct semaphore leave;         /* clone한 스레드가 나갈 때마다 up */
+	bool exiting;                   /* 프로세스 전체가 끝나는 중 */
+	int exit_status;                /* EXITING이면 프로세스의 종료 상태 */
+};
+
+/* clone()한 스레드 하나의 종료 정보.  join한 스레드가 해제하고,
+   아무도 join하지 않으면 leader가 나갈 때 해제한다. */
+struct uthread_info {
+	tid_t tid;
+	int exit_status;                /* thread_exit()이나 exit()에 넘긴 값 */
+	bool alone;                     /* thread_exit()으로 이 스레드만 나감 */
+	struct semaphore done;          /* 스레드가 나가면 up */
+	struct list_elem elem;          /* proc_group의 threads 원소 */
+};
+
+void process_cache_init (void);
 tid_t process_create_initd (const char *file_name);
 tid_t process_fork (const char *name, struct intr_frame *if_);
+tid_t process_clone (void *entry, void *arg, void *stack,
+		struct intr_frame *if_);
+int process_join (tid_t);
 int process_exec (void *f_name);
 int process_wait (tid_t);
 void process_exit (void);
@@ -0,0 +1,299 @@
+/* Red-black tree.
+
+   See rbtree.h for basic information.  The algorithms follow
+   [CLRS] chapter 13, using null pointers instead of a sentinel
+   leaf, so removal tracks the parent of the node that replaced
+   the removed one explicitly. */
+
+#include "rbtree.h"
+#include "../debug.h"
+
+static void rotate_left (struct rb_tree *, struct rb_elem *);
+static void rotate_right (struct rb_tree *, struct rb_elem *);
+static void insert_fixup (struct rb_tree *, struct rb_elem *);
+static void remove_fixup (struct rb_tree *, struct rb_elem *,
+		struct rb_elem *parent);
+static void transplant (struct rb_tree *, struct rb_elem *,
+		struct rb_elem *);
+
+static inline bool
+is_red (const struct rb_elem *e) {
+	return e != NULL && e->red;
+}
+
+/* Initializes T as an empty tree ordered by LESS, given
+   auxiliary data AUX. */
+void
+rb_init (struct rb_tree *t, rb_less_func *less, void *aux) {
+	ASSERT (t != NULL);
+	ASSERT (less != NULL);
+
+	t->root = NULL;
+	t->first = NULL;
+	t->size = 0;
+	t->less = less;
+	t->aux = aux;
+}
+
+/* Inserts E into T.  E is placed after all the elements that
+   compare equal to it. */
+void
+rb_insert (struct rb_tree *t, struct rb_elem *e) {
+	struct rb_elem *parent = NULL;
+	struct rb_elem **link = &t->root;
+	bool leftmost = true;
+
+	ASSERT (t != NULL);
+	ASSERT (e != NULL);
+
+	while (*link != NULL) {
+		parent = *link;
+		if (t->less (e, parent, t->aux))
+			link = &parent->left;
+		else {
+			link = &parent->right;
+			leftmost = false;
+		}
+	}
+
+	e->parent = parent;
+	e->left = e->right = NULL;
+	e->red = true;
+	*link = e;
+	if (leftmost)
+		t->first = e;
+	t->size++;
+
+	insert_fixup (t, e);
+}
+
+/* Removes E, which must be in T, from T. */
+void
+rb_remove (struct rb_tree *t, struct rb_elem *e) {
+	struct rb_elem *child, *parent;
+	bool removed_red;
+
+	ASSERT (t != NULL);
+	ASSERT (e != NULL);
+	ASSERT (t->size > 0);
+
+	if (t->first == e)
+		t->first = rb_next (e);
+
+	if (e->left == NULL || e->right == NULL) {
+		/* At most one child: splice E out directly. */
+		child = e->left != NULL ? e->left : e->right;
+		parent = e->parent;
+		removed_red = e->red;
+		transplant (t, e, child);
+	} else {
+		/* Two children: move E's successor S into E's place. */
+		struct rb_elem *s = e->right;
+		while (s->left != NULL)
+			s = s->left;
+
+		removed_red = s->red;
+		child = s->right;
+		if (s->parent == e)
+			parent = s;
+		else {
+			parent = s->parent;
+			transplant (t, s, s->right);
+			s->right = e->right;
+			s->right->parent = s;
+		}
+		transplant (t, e, s);
+		s->left = e->left;
+		s->left->parent = s;
+		s->red = e->red;
+	}
+	t->size--;
+
+	if (!removed_red)
+		remove_fixup (t, child, parent);
+}
+
+/* Returns the smallest element in T, or a null pointer if T is
+   empty.  Takes O(1) time. */
+struct rb_elem *
+rb_first (const struct rb_tree *t) {
+	ASSERT (t != NULL);
+	return t->first;
+}
+
+/* Returns the element that follows E in its tree, or a null
+   pointer if E is the largest element. */
+struct rb_elem *
+rb_next (const struct rb_elem *e) {
+	ASSERT (e != NULL);
+
+	if (e->right != NULL) {
+		e = e->right;
+		while (e->left != NULL)
+			e = e->left;
+		return (struct rb_elem *) e;
+	}
+	while (e->parent != NULL && e == e->parent->right)
+		e = e->parent;
+	return e->parent;
+}
+
+/* Returns the number of elements in T. */
+size_t
+rb_size (const struct rb_tree *t) {
+	ASSERT (t != NULL);
+	return t->size;
+}
+
+/* Returns true if T is empty, false otherwise. */
+bool
+rb_empty (const struct rb_tree *t) {
+	ASSERT (t != NULL);
+	return t->root == NULL;
+}
+
+/* Replaces the subtree rooted at U by the subtree rooted at V,
+   which may be null. */
+static void
+transplant (struct rb_tree *t, struct rb_elem *u, struct rb_elem *v) {
+	if (u->parent == NULL)
+		t->root = v;
+	else if (u == u->parent->left)
+		u->parent->left = v;
+	else
+		u->parent->right = v;
+	if (v != NULL)
+		v->parent = u->parent;
+}
+
+static void
+rotate_left (struct rb_tree *t, struct rb_elem *x) {
+	struct rb_elem *y = x->right;
+
+	x->right = y->left;
+	if (y->left != NULL)
+		y->left->parent = x;
+	transplant (t, x, y);
+	y->left = x;
+	x->parent = y;
+}
+
+static void
+rotate_right (struct rb_tree *t, struct rb_elem *x) {
+	struct rb_elem *y = x->left;
+
+	x->left = y->right;
+	if (y->right != NULL)
+		y->right->parent = x;
+	transplant (t, x, y);
+	y->right = x;
+	x->parent = y;
+}
+
+/* Restores the red-black properties after inserting red
+   element E. */
+static void
+insert_fixup (struct rb_tree *t, struct rb_elem *e) {
+	while (is_red (e->parent)) {
+		struct rb_elem *p = e->parent;
+		struct rb_elem *g = p->parent;
+
+		if (p == g->left) {
+			struct rb_elem *uncle = g->right;
+			if (is_red (uncle)) {
+				p->red = uncle->red = false;
+				g->red = true;
+				e = g;
+			} else {
+				if (e == p->right) {
+					rotate_left (t, p);
+					e = p;
+					p = e->parent;
+				}
+				p->red = false;
+				g->red = true;
+				rotate_right (t, g);
+			}
+		} else {
+			struct rb_elem *uncle = g->left;
+			if (is_red (uncle)) {
+				p->red = uncle->red = false;
+				g->red = true;
+				e = g;
+			} else {
+				if (e == p->left) {
+					rotate_right (t, p);
+					e = p;
+					p = e->parent;
+				}
+				p->red = false;
+				g->red = true;
+				rotate_left (t, g);
+			}
+		}
+	}
+	t->root->red = false;
+}
+
+/* Restores the red-black properties after removing a black
+   element.  X, possibly null, is the element that took its
+   place and PARENT is X's parent. */
+static void
+remove_fixup (struct rb_tree *t, struct rb_elem *x,
+		struct rb_elem *parent) {
+	while (x != t->root && !is_red (x)) {
+		if (x == parent->left) {
+			struct rb_elem *w = parent->right;
+			if (is_red (w)) {
+				w->red = false;
+				parent->red = true;
+				rotate_left (t, parent);
+				w = parent->right;
+			}
+			if (!is_red (w->left) && !is_red (w->right)) {
+				w->red = true;
+				x = parent;
+				parent = x->parent;
+			} else {
+				if (!is_red (w->right)) {
+					w->left->red = false;
+					w->red = true;
+					rotate_right (t, w);
+					w = parent->right;
+				}
+				w->red = parent->red;
+				parent->red = false;
+				w->right->red = false;
+				rotate_left (t, parent);
+				x = t->root;
+			}
+		} else {
+			struct rb_elem *w = parent->left;
+			if (is_red (w)) {
+				w->red = false;
+				parent->red = true;
+				rotate_right (t, parent);
+				w = parent->left;
+			}
+			if (!is_red (w->left) && !is_red (w->right)) {
+				w->red = true;
+				x = parent;
+				parent = x->parent;
+			} else {
+				if (!is_red (w->left)) {
+					w->right->red = false;
+					w->red = true;
+					rotate_left (t, w);
+					w = parent->left;
+				}
+				w->red = parent->red;
+				parent->red = false;
+				w->left->red = false;
+				rotate_right (t, parent);
+				x = t->root;
+			}
+		}
+	}
+	if (x != NULL)
+		x->red = false;
+}
@@ -145,6 +145,37 @@ dup2 (int oldfd, int newfd){
 	return syscall2 (SYS_DUP2, oldfd, newfd);
 }
 
+bool
+threadstats (struct thread_stats *stats) {
+	return syscall1 (SYS_THREADSTATS, stats);
+}
+
+tid_t
+clone (void (*entry) (void *), void *arg, void *stack) {
+	return (tid_t) syscall3 (SYS_CLONE, entry, arg, stack);
+}
+
+int
+thread_join (tid_t tid) {
+	return syscall1 (SYS_THREAD_JOIN, tid);
+}
+
+void
+thread_exit (int status) {
+	syscall1 (SYS_THREAD_EXIT, status);
+	NOT_REACHED ();
+}
+
+int
+futex_wait (int *addr, int expected) {
+	return syscall2 (SYS_FUTEX_WAIT, addr, expected);
+}
+
+int
+futex_wake (int *addr, int cnt) {
+	return syscall2 (SYS_FUTEX_WAKE, addr, cnt);
+}
+
 void *
 mmap (void *addr, size_t length, int writable, int fd, off_t offset) {
 	return (void *) syscall5 (SYS_MMAP, addr, length, writable, fd, offset);
@@ -0,0 +1,175 @@
+#include <uthread.h>
+#include <debug.h>
+#include <limits.h>
+#include <stdint.h>
+
+/* A stack slot and the thread running on it. */
+struct slot
+  {
+    int busy;                   /* Nonzero while the slot is taken. */
+    tid_t tid;                  /* Thread using the slot. */
+    uthread_func *func;         /* Function it runs... */
+    void *aux;                  /* ...and its argument. */
+  };
+
+static struct slot slots[UTHREAD_MAX];
+static uint8_t stacks[UTHREAD_MAX][UTHREAD_STACK_SIZE]
+  __attribute__ ((aligned (16)));
+
+static void start (void *slot_) NO_RETURN;
+
+/* Starts a thread running FUNC (AUX) and returns its thread
+   identifier, or TID_ERROR if all slots are in use or the
+   kernel cannot create the thread. */
+tid_t
+uthread_create (uthread_func *func, void *aux)
+{
+  int i;
+
+  for (i = 0; i < UTHREAD_MAX; i++)
+    if (__sync_lock_test_and_set (&slots[i].busy, 1) == 0)
+      {
+        struct slot *s = &slots[i];
+        tid_t tid;
+
+        s->func = func;
+        s->aux = aux;
+        s->tid = TID_ERROR;
+        tid = clone (start, s, stacks[i] + UTHREAD_STACK_SIZE);
+        if (tid == TID_ERROR)
+          __sync_lock_release (&s->busy);
+        else
+          s->tid = tid;
+        return tid;
+      }
+  return TID_ERROR;
+}
+
+/* Waits for thread TID, which must have been created by
+   uthread_create(), to exit and returns its exit status.
+   Returns -1 if TID is not a thread of this process or has
+   already been joined. */
+int
+uthread_join (tid_t tid)
+{
+  int status = thread_join (tid);
+  int i;
+
+  /* The kernel wakes us only after TID has left its stack. */
+  for (i = 0; i < UTHREAD_MAX; i++)
+    if (slots[i].busy && slots[i].tid == tid)
+      {
+        slots[i].tid = TID_ERROR;
+        __sync_lock_release (&slots[i].busy);
+        break;
+      }
+  return status;
+}
+
+/* Ends the calling thread with exit status STATUS. */
+void
+uthread_exit (int status)
+{
+  thread_exit (status);
+}
+
+/* First function run by every thread. */
+static void
+start (void *slot_)
+{
+  struct slot *s = slot_;
+
+  uthread_exit (s->func (s->aux));
+}
+
+/* Mutexes follow the three-state design from Drepper's
+   "Futexes Are Tricky": unlock only enters the kernel when the
+   state says someone may be waiting. */
+
+/* Initializes M as unlocked. */
+void
+uthread_mutex_init (struct uthread_mutex *m)
+{
+  m->state = 0;
+  m->contended = 0;
+}
+
+/* Acquires M, sleeping in the kernel while another thread holds
+   it. */
+void
+uthread_mutex_lock (struct uthread_mutex *m)
+{
+  int c = __sync_val_compare_and_swap (&m->state, 0, 1);
+
+  if (c == 0)
+    return;
+
+  /* Mark M contended so that the holder wakes us up. */
+  if (c != 2)
+    c = __sync_lock_test_and_set (&m->state, 2);
+  while (c != 0)
+    {
+      futex_wait (&m->state, 2);
+      c = __sync_lock_test_and_set (&m->state, 2);
+    }
+  m->contended++;
+}
+
+/* Acquires M if it is free and returns true, or returns false
+   without waiting. */
+bool
+uthread_mutex_trylock (struct uthread_mutex *m)
+{
+  return __sync_val_compare_and_swap (&m->state, 0, 1) == 0;
+}
+
+/* Releases M, which the caller must hold. */
+void
+uthread_mutex_unlock (struct uthread_mutex *m)
+{
+  if (__sync_fetch_and_sub (&m->state, 1) != 1)
+    {
+      m->state = 0;
+      futex_wake (&m->state, 1);
+    }
+}
+
+/* Initializes C. */
+void
+uthread_cond_init (struct uthread_cond *c)
+{
+  c->seq = 0;
+}
+
+/* Atomically releases M and waits for C to be signaled, then
+   reacquires M.  As with any condition variable, the caller must
+   recheck its condition after waking. */
+void
+uthread_cond_wait (struct uthread_cond *c, struct uthread_mutex *m)
+{
+  int seq = c->seq;
+
+  uthread_mutex_unlock (m);
+  futex_wait (&c->seq, seq);
+
+  /* Other waiters may have been woken with us, so take M in the
+     contended state to make sure its next unlock wakes them. */
+  while (__sync_lock_test_and_set (&m->state, 2) != 0)
+    futex_wait (&m->state, 2);
+}
+
+/* Wakes one thread waiting on C, if any. */
+void
+uthread_cond_signal (struct uthread_cond *c)
+{
+  __sync_fetch_and_add (&c->seq, 1);
+  futex_wake (&c->seq, 1);
+}
+
+/* Wakes all threads waiting on C. */
+void
+uthread_cond_broadcast (struct uthread_cond *c)
+{
+  __sync_fetch_and_add (&c->seq, 1);
+  futex_wake (&c->seq, INT_MAX);
+}
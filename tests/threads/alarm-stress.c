@@ -0,0 +1,108 @@
+/* Puts a large number of threads to sleep with scattered,
+   random deadlines and checks that none of them wakes up before
+   its deadline and that they run in order of their deadlines.
+   Sleepers all have the same priority and do too little after
+   waking to use up a time slice, so they run in the order the
+   timer woke them.  Also reports how much time the timer interrupt
+   handler spent managing the sleep queue while they slept. */
+
+#include <stdio.h>
+#include <random.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of sleeping threads. */
+#define SLEEPER_CNT 10000
+
+/* Deadlines are chosen uniformly in [1, MAX_SLEEP] ticks
+   after the sleeper starts. */
+#define MAX_SLEEP 500
+
+/* Information about the test. */
+struct stress_test
+  {
+    struct semaphore done;      /* Upped by each sleeper. */
+    int early;                  /* Sleepers that woke up too early. */
+    int64_t last_deadline;      /* Deadline of the last sleeper to run. */
+    int out_of_order;           /* Sleepers that ran after a later one. */
+  };
+
+static void sleeper (void *);
+
+void
+test_alarm_stress (void)
+{
+  struct stress_test test;
+  int64_t start_ticks, elapsed;
+  uint64_t start_cycles, cycles;
+  int created, i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&test.done, 0);
+  test.early = 0;
+  test.last_deadline = 0;
+  test.out_of_order = 0;
+
+  msg ("Creating %d threads with random deadlines of up to %d ticks.",
+       SLEEPER_CNT, MAX_SLEEP);
+
+  /* Run above the sleepers so that all of them are created
+     before any of them goes to sleep. */
+  thread_set_priority (PRI_DEFAULT + 1);
+
+  start_ticks = timer_ticks ();
+  start_cycles = timer_intr_cycles ();
+  for (created = 0; created < SLEEPER_CNT; created++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "sleeper %d", created);
+      if (thread_create (name, PRI_DEFAULT, sleeper, &test) == TID_ERROR)
+        break;
+    }
+  if (created < SLEEPER_CNT)
+    msg ("Ran out of memory after %d threads.", created);
+
+  thread_set_priority (PRI_DEFAULT);
+  for (i = 0; i < created; i++)
+    sema_down (&test.done);
+
+  elapsed = timer_elapsed (start_ticks);
+  cycles = timer_intr_cycles () - start_cycles;
+  if (test.early != 0)
+    fail ("%d of %d threads woke up before their deadline.",
+          test.early, created);
+  if (test.out_of_order != 0)
+    fail ("%d of %d threads woke up after a thread with a later deadline.",
+          test.out_of_order, created);
+  msg ("All %d threads woke up on time, in deadline order.", created);
+  msg ("Timer interrupt: %llu cycles over %lld ticks (%llu cycles/tick).",
+       cycles, elapsed, elapsed > 0 ? cycles / elapsed : 0);
+  pass ();
+}
+
+/* Sleeper thread. */
+static void
+sleeper (void *test_)
+{
+  struct stress_test *test = test_;
+  int64_t sleep = random_ulong () % MAX_SLEEP + 1;
+  int64_t deadline = timer_ticks () + sleep;
+  enum intr_level old_level;
+
+  timer_sleep (sleep);
+  old_level = intr_disable ();
+  if (timer_ticks () < deadline)
+    test->early++;
+  if (deadline < test->last_deadline)
+    test->out_of_order++;
+  test->last_deadline = deadline;
+  intr_set_level (old_level);
+  sema_up (&test->done);
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+# The timer interrupt cost varies from run to run; it is printed
+# for comparison but not checked.
+our ($test);
+my (@output) = grep (!/^\(alarm-stress\) Timer interrupt: \d+ cycles/,
+		     read_text_file ("$test.output"));
+common_checks ("run", @output);
+compare_output ("run", \@output, [<<'EOF']);
+(alarm-stress) begin
+(alarm-stress) Creating 10000 threads with random deadlines of up to 500 ticks.
+(alarm-stress) All 10000 threads woke up on time, in deadline order.
+(alarm-stress) PASS
+(alarm-stress) end
+EOF
+pass;
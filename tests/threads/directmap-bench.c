@@ -0,0 +1,77 @@
+/* Measures kernel accesses that are sensitive to TLB reach
+   through the direct map: touching one word in each page of a
+   4 MB block, the access pattern of walking a large table, and
+   copying page by page, the pattern of duplicate_pte() during
+   fork.  With 2 MB direct-map pages the whole block is covered by
+   two TLB entries instead of 1024.
+
+   Any 4 MB run of physical memory contains a whole 2 MB-aligned
+   chunk, and palloc never hands out the kernel text, so the test
+   first checks that such a chunk inside the block really is
+   mapped by a single PDE with PTE_PS set. */
+
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/mmu.h"
+#include "threads/palloc.h"
+#include "threads/pte.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+
+#define BLOCK_PAGES 1024
+#define COPY_PAGES 256
+#define ROUNDS 20
+
+void
+test_directmap_bench (void)
+{
+  uint8_t *block;
+  uint8_t *copy[COPY_PAGES];
+  unsigned long long touch_cycles = 0, copy_cycles = 0;
+  uint64_t large_pa, *pde;
+  int round, i;
+
+  block = palloc_get_multiple (PAL_ASSERT | PAL_ZERO, BLOCK_PAGES);
+
+  large_pa = ROUND_UP (vtop (block), LARGE_PGSIZE);
+  pde = pml4e_walk (base_pml4, (uint64_t) ptov (large_pa), 0);
+  if (pde == NULL || !(*pde & PTE_PS))
+    fail ("direct map of physical address %#llx is not a 2 MB page.",
+          (unsigned long long) large_pa);
+  if (PTE_ADDR (*pde) != large_pa)
+    fail ("2 MB page at %#llx maps physical address %#llx.",
+          (unsigned long long) large_pa,
+          (unsigned long long) PTE_ADDR (*pde));
+  msg ("Block is mapped with 2 MB pages.");
+
+  for (i = 0; i < COPY_PAGES; i++)
+    copy[i] = palloc_get_page (PAL_ASSERT);
+
+  for (round = 0; round < ROUNDS; round++)
+    {
+      uint64_t start = rdtsc ();
+      for (i = 0; i < BLOCK_PAGES; i++)
+        block[(size_t) i * PGSIZE + (round * 64) % PGSIZE]++;
+      touch_cycles += rdtsc () - start;
+
+      start = rdtsc ();
+      for (i = 0; i < COPY_PAGES; i++)
+        memcpy (copy[i], block + (size_t) (i * 4 % BLOCK_PAGES) * PGSIZE,
+                PGSIZE);
+      copy_cycles += rdtsc () - start;
+    }
+
+  msg ("%llu cycles per page touched.",
+       touch_cycles / (ROUNDS * BLOCK_PAGES));
+  msg ("%llu cycles per page copied.",
+       copy_cycles / (ROUNDS * COPY_PAGES));
+
+  for (i = 0; i < COPY_PAGES; i++)
+    palloc_free_page (copy[i]);
+  palloc_free_multiple (block, BLOCK_PAGES);
+
+  pass ();
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+# The cycle counts vary from run to run; they are printed for
+# comparison but not checked.
+our ($test);
+my (@output) = grep (!/^\(directmap-bench\) \d+ cycles per page \w+\.$/,
+		     read_text_file ("$test.output"));
+common_checks ("run", @output);
+compare_output ("run", \@output, [<<'EOF']);
+(directmap-bench) begin
+(directmap-bench) Block is mapped with 2 MB pages.
+(directmap-bench) PASS
+(directmap-bench) end
+EOF
+pass;
@@ -0,0 +1,109 @@
+/* Measures how much time the timer interrupt spends per tick
+   when the MLFQS is managing many threads.
+
+   The main thread first sleeps for a second with nothing else
+   runnable to get a baseline, then starts 64 threads with
+   different nice values that spin for 10 seconds, and reports
+   the timer interrupt cycles per tick for both periods.  With
+   per-tick work limited to the running thread, the loaded
+   figure should stay within a small factor of the baseline
+   instead of growing with the number of threads.
+
+   The cycle counts are only reported.  What is checked is that
+   the main thread, at nice -20, still gets the CPU within a time
+   slice of waking up behind 64 spinners, and that the load
+   average after the spin is close to the expected
+   64 * (1 - (59/60)**10) = 9.90. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/sched.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 64
+#define SPIN_SECONDS 10
+
+static int64_t spin_until;
+static struct semaphore done;
+
+static void spin_thread (void *nice_);
+static uint64_t cycles_per_tick (int64_t ticks);
+
+void
+test_mlfqs_overhead (void) 
+{
+  uint64_t idle_cycles, load_cycles;
+  int64_t start, late;
+  int load_avg;
+  int i;
+
+  ASSERT (thread_mlfqs);
+
+  /* Stay ahead of the spinners so that we notice when they are done. */
+  thread_set_nice (-20);
+  sema_init (&done, 0);
+
+  timer_sleep (1);
+  idle_cycles = cycles_per_tick (TIMER_FREQ);
+
+  msg ("Starting %d load threads...", THREAD_CNT);
+  start = timer_ticks ();
+  spin_until = start + SPIN_SECONDS * TIMER_FREQ;
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "load %d", i);
+      thread_create (name, PRI_DEFAULT, spin_thread, (void *) (intptr_t) (i % 21));
+    }
+  load_cycles = cycles_per_tick (spin_until - timer_ticks ());
+
+  /* The sleep may have started a tick late, and the timer does
+     not preempt on wakeup, so allow one time slice past that. */
+  late = timer_ticks () - spin_until;
+  if (late > TIME_SLICE + 1)
+    fail ("main thread ran %lld ticks after the spinners' deadline.", late);
+  msg ("Main thread ran within a time slice of waking up.");
+
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&done);
+  load_avg = thread_get_load_avg ();
+  if (load_avg < 850 || load_avg > 1150)
+    fail ("load average is %d.%02d but should be between 8.50 and 11.50.",
+          load_avg / 100, load_avg % 100);
+  msg ("Load average is between 8.50 and 11.50.");
+
+  msg ("Idle: %llu cycles per tick in the timer interrupt.", idle_cycles);
+  msg ("%d threads: %llu cycles per tick in the timer interrupt.",
+       THREAD_CNT, load_cycles);
+  msg ("Load average after %d seconds: %d.%02d.", SPIN_SECONDS,
+       load_avg / 100, load_avg % 100);
+  pass ();
+}
+
+/* Sleeps for TICKS timer ticks and returns the average number
+   of cycles the timer interrupt handler spent per tick. */
+static uint64_t
+cycles_per_tick (int64_t ticks) 
+{
+  int64_t start = timer_ticks ();
+  uint64_t cycles = timer_intr_cycles ();
+  int64_t elapsed;
+
+  timer_sleep (ticks);
+  elapsed = timer_elapsed (start);
+  cycles = timer_intr_cycles () - cycles;
+  return elapsed > 0 ? cycles / elapsed : 0;
+}
+
+static void
+spin_thread (void *nice_) 
+{
+  thread_set_nice ((intptr_t) nice_);
+  while (timer_ticks () < spin_until)
+    continue;
+  sema_up (&done);
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+# The cycle counts and the exact load average vary from run to run;
+# they are printed for comparison but not checked.
+our ($test);
+my (@output) = grep (!/^\(mlfqs-overhead\) .*\d+ cycles per tick in the timer interrupt\.$/
+		     && !/^\(mlfqs-overhead\) Load average after \d+ seconds: \d+\.\d\d\.$/,
+		     read_text_file ("$test.output"));
+common_checks ("run", @output);
+compare_output ("run", \@output, [<<'EOF']);
+(mlfqs-overhead) begin
+(mlfqs-overhead) Starting 64 load threads...
+(mlfqs-overhead) Main thread ran within a time slice of waking up.
+(mlfqs-overhead) Load average is between 8.50 and 11.50.
+(mlfqs-overhead) PASS
+(mlfqs-overhead) end
+EOF
+pass;
@@ -0,0 +1,64 @@
+/* Exercises the buddy page allocator with multi-page requests
+   whose sizes are not powers of two, checks that the blocks it
+   hands out do not overlap, and that freeing them in a scrambled
+   order coalesces back into a maximum-order block.  Requests
+   larger than the maximum order must fail. */
+
+#include <stdint.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+#define BLOCK_CNT 8
+#define MAX_BLOCK_PAGES 1024
+
+static const size_t sizes[BLOCK_CNT] = { 1, 3, 5, 8, 17, 2, 31, 64 };
+static const int free_order[BLOCK_CNT] = { 3, 0, 6, 1, 7, 4, 2, 5 };
+
+static void
+check_block (uint8_t *block, size_t page_cnt, uint8_t value)
+{
+  size_t i;
+
+  for (i = 0; i < page_cnt * PGSIZE; i++)
+    if (block[i] != value)
+      fail ("block %p byte %zu is 0x%02x, expected 0x%02x",
+            block, i, block[i], value);
+}
+
+void
+test_palloc_buddy (void)
+{
+  uint8_t *blocks[BLOCK_CNT];
+  uint8_t *big;
+  int round, i;
+
+  for (round = 0; round < 2; round++)
+    {
+      for (i = 0; i < BLOCK_CNT; i++)
+        {
+          blocks[i] = palloc_get_multiple (PAL_ZERO, sizes[i]);
+          if (blocks[i] == NULL)
+            fail ("allocating %zu pages failed", sizes[i]);
+          check_block (blocks[i], sizes[i], 0);
+          memset (blocks[i], i + 1, sizes[i] * PGSIZE);
+        }
+      for (i = 0; i < BLOCK_CNT; i++)
+        check_block (blocks[i], sizes[i], i + 1);
+      for (i = 0; i < BLOCK_CNT; i++)
+        palloc_free_multiple (blocks[free_order[i]], sizes[free_order[i]]);
+    }
+  msg ("non-overlapping blocks of odd sizes.");
+
+  big = palloc_get_multiple (0, MAX_BLOCK_PAGES);
+  if (big == NULL)
+    fail ("allocating %d pages failed", MAX_BLOCK_PAGES);
+  memset (big, 0x5a, MAX_BLOCK_PAGES * PGSIZE);
+  palloc_free_multiple (big, MAX_BLOCK_PAGES);
+  msg ("allocated a %d-page block.", MAX_BLOCK_PAGES);
+
+  if (palloc_get_multiple (0, MAX_BLOCK_PAGES + 1) != NULL)
+    fail ("allocating %d pages succeeded", MAX_BLOCK_PAGES + 1);
+  msg ("%d-page request refused.", MAX_BLOCK_PAGES + 1);
+}
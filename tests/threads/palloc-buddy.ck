@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-buddy) begin
+(palloc-buddy) non-overlapping blocks of odd sizes.
+(palloc-buddy) allocated a 1024-page block.
+(palloc-buddy) 1025-page request refused.
+(palloc-buddy) end
+EOF
+pass;
@@ -0,0 +1,48 @@
+/* Checks that PAL_ZERO pages come back zeroed whether they are
+   taken from the reserve the idle thread fills or zeroed on the
+   spot.  Freed pages are poisoned in debug builds, so a page that
+   slipped into the reserve without being zeroed would show up. */
+
+#include <stdint.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+#define PAGE_CNT 160
+
+static void
+check_zeroed (enum palloc_flags flags)
+{
+  static uint8_t *pages[PAGE_CNT];
+  int i;
+  size_t j;
+
+  for (i = 0; i < PAGE_CNT; i++)
+    {
+      pages[i] = palloc_get_page (flags | PAL_ZERO);
+      if (pages[i] == NULL)
+        fail ("allocating page %d failed", i);
+      for (j = 0; j < PGSIZE; j++)
+        if (pages[i][j] != 0)
+          fail ("page %d byte %zu is 0x%02x", i, j, pages[i][j]);
+      pages[i][0] = 0xff;
+    }
+  for (i = 0; i < PAGE_CNT; i++)
+    palloc_free_page (pages[i]);
+}
+
+void
+test_palloc_zero (void)
+{
+  int round;
+
+  for (round = 0; round < 3; round++)
+    {
+      /* Give the idle thread time to refill the reserves. */
+      timer_sleep (10);
+      check_zeroed (0);
+      check_zeroed (PAL_USER);
+    }
+  msg ("all PAL_ZERO pages were zero.");
+}
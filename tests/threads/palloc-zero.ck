@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-zero) begin
+(palloc-zero) all PAL_ZERO pages were zero.
+(palloc-zero) end
+EOF
+pass;
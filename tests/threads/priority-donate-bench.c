@@ -0,0 +1,173 @@
+/* Measures the cost of priority donation.
+
+   Chain: the main thread holds lock 0.  Thread k (k = 1...DEPTH)
+   at priority PRI_DEFAULT + k acquires lock k and then blocks on
+   lock k - 1, so each new thread donates along a chain of k
+   holders down to the main thread.
+
+   Waiters: the main thread holds one lock and WAITER_CNT threads
+   block on it.  They are created in ascending priority order so
+   that each one preempts the (donated) main thread and blocks.
+   Releasing the lock hands it to every waiter in priority order.
+
+   Also checks that the main thread ends up with the top priority
+   of the chain, that releasing lock 0 unwinds the chain from the
+   top down, as in priority-donate-chain, and that waiters get the
+   lock in priority order.  Only those results are compared by the
+   checker; the cycle counts are just reported. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "intrinsic.h"
+
+#define DEPTH (PRI_MAX - PRI_DEFAULT)
+#define WAITER_CNT 200
+#define ROUNDS 10
+
+struct chain_link
+  {
+    int id;                     /* 1...DEPTH. */
+    struct lock *mine;          /* Lock to hold while waiting, or NULL. */
+    struct lock *wait;          /* Lock held by the previous link. */
+    struct semaphore *done;     /* Upped on exit. */
+  };
+
+struct waiter_test
+  {
+    struct lock lock;           /* Lock everybody waits on. */
+    int last;                   /* Priority of the previous holder. */
+    int out_of_order;           /* Holders above the previous one. */
+    struct semaphore done;      /* Upped by each waiter. */
+  };
+
+/* Chain thread expected to finish next, and how many did not. */
+static int chain_next;
+static int chain_out_of_order;
+
+static thread_func chain_thread;
+static thread_func waiter_thread;
+
+void
+test_priority_donate_bench (void)
+{
+  static struct lock locks[DEPTH];
+  static struct chain_link links[DEPTH + 1];
+  static struct waiter_test wt;
+  struct semaphore done;
+  uint64_t start, chain_cycles = 0, block_cycles = 0, handoff_cycles = 0;
+  int round, i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  sema_init (&done, 0);
+  for (i = 0; i < DEPTH; i++)
+    lock_init (&locks[i]);
+  for (i = 1; i <= DEPTH; i++)
+    {
+      links[i].id = i;
+      links[i].mine = i < DEPTH ? &locks[i] : NULL;
+      links[i].wait = &locks[i - 1];
+      links[i].done = &done;
+    }
+
+  chain_out_of_order = 0;
+  for (round = 0; round < ROUNDS; round++)
+    {
+      chain_next = DEPTH;
+      lock_acquire (&locks[0]);
+      start = rdtsc ();
+      for (i = 1; i <= DEPTH; i++)
+        {
+          char name[16];
+          snprintf (name, sizeof name, "chain %d", i);
+          thread_create (name, PRI_DEFAULT + i, chain_thread, &links[i]);
+        }
+      chain_cycles += rdtsc () - start;
+      if (thread_get_priority () != PRI_DEFAULT + DEPTH)
+        fail ("main has priority %d with a chain of %d, should be %d.",
+              thread_get_priority (), DEPTH, PRI_DEFAULT + DEPTH);
+      lock_release (&locks[0]);
+      for (i = 1; i <= DEPTH; i++)
+        sema_down (&done);
+      if (thread_get_priority () != PRI_DEFAULT)
+        fail ("main has priority %d after releasing the chain.",
+              thread_get_priority ());
+    }
+  if (chain_out_of_order != 0)
+    fail ("%d chain threads finished out of order.", chain_out_of_order);
+  msg ("Main got priority %d from a chain of %d.", PRI_DEFAULT + DEPTH, DEPTH);
+  msg ("Chain unwound from the top down.");
+  msg ("Main dropped back to priority %d.", PRI_DEFAULT);
+  msg ("Chain of %d: %llu cycles per donating acquire.",
+       DEPTH, chain_cycles / (ROUNDS * DEPTH));
+
+  lock_init (&wt.lock);
+  sema_init (&wt.done, 0);
+  wt.out_of_order = 0;
+  for (round = 0; round < ROUNDS; round++)
+    {
+      lock_acquire (&wt.lock);
+      wt.last = PRI_MAX;
+      start = rdtsc ();
+      for (i = 0; i < WAITER_CNT; i++)
+        {
+          char name[16];
+          snprintf (name, sizeof name, "waiter %d", i);
+          thread_create (name, PRI_DEFAULT + 1 + i * DEPTH / WAITER_CNT,
+                         waiter_thread, &wt);
+        }
+      block_cycles += rdtsc () - start;
+
+      start = rdtsc ();
+      lock_release (&wt.lock);
+      for (i = 0; i < WAITER_CNT; i++)
+        sema_down (&wt.done);
+      handoff_cycles += rdtsc () - start;
+    }
+  if (wt.out_of_order != 0)
+    fail ("%d waiters got the lock out of priority order.",
+          wt.out_of_order);
+  msg ("%d waiters got the lock in priority order.", WAITER_CNT);
+  msg ("%d waiters: %llu cycles per blocking acquire, "
+       "%llu cycles per handoff.", WAITER_CNT,
+       block_cycles / (ROUNDS * WAITER_CNT),
+       handoff_cycles / (ROUNDS * WAITER_CNT));
+  pass ();
+}
+
+static void
+chain_thread (void *link_)
+{
+  struct chain_link *link = link_;
+
+  if (link->mine != NULL)
+    lock_acquire (link->mine);
+  lock_acquire (link->wait);
+  lock_release (link->wait);
+  if (link->mine != NULL)
+    lock_release (link->mine);
+  if (link->id != chain_next)
+    chain_out_of_order++;
+  chain_next--;
+  sema_up (link->done);
+}
+
+static void
+waiter_thread (void *wt_)
+{
+  struct waiter_test *wt = wt_;
+
+  lock_acquire (&wt->lock);
+  if (thread_get_priority () > wt->last)
+    wt->out_of_order++;
+  wt->last = thread_get_priority ();
+  lock_release (&wt->lock);
+  sema_up (&wt->done);
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+# The cycle counts vary from run to run; they are printed for
+# comparison but not checked.
+our ($test);
+my (@output) = grep (!/^\(priority-donate-bench\) .*\d+ cycles per /,
+		     read_text_file ("$test.output"));
+common_checks ("run", @output);
+compare_output ("run", \@output, [<<'EOF']);
+(priority-donate-bench) begin
+(priority-donate-bench) Main got priority 63 from a chain of 32.
+(priority-donate-bench) Chain unwound from the top down.
+(priority-donate-bench) Main dropped back to priority 31.
+(priority-donate-bench) 200 waiters got the lock in priority order.
+(priority-donate-bench) PASS
+(priority-donate-bench) end
+EOF
+pass;
@@ -0,0 +1,75 @@
+/* The main thread read-locks an rwlock.  A second reader gets
+   in alongside it.  Then a higher-priority writer blocks waiting
+   for the main thread to finish reading, donating its priority,
+   and a reader that arrives after the writer has to wait behind
+   it.  When the main thread releases its read lock, the writer
+   runs first and the late reader after it. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func reader_thread_func;
+static thread_func writer_thread_func;
+static thread_func late_reader_thread_func;
+
+void
+test_priority_donate_rwlock (void)
+{
+  struct rwlock rw;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rw_init (&rw);
+  rw_read_acquire (&rw);
+  thread_create ("reader", PRI_DEFAULT + 1, reader_thread_func, &rw);
+  thread_create ("writer", PRI_DEFAULT + 5, writer_thread_func, &rw);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 5, thread_get_priority ());
+  thread_create ("late reader", PRI_DEFAULT + 3, late_reader_thread_func, &rw);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 5, thread_get_priority ());
+  rw_read_release (&rw);
+  msg ("writer, late reader must already have finished, in that order.");
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT, thread_get_priority ());
+}
+
+static void
+reader_thread_func (void *rw_)
+{
+  struct rwlock *rw = rw_;
+
+  rw_read_acquire (rw);
+  msg ("reader: got the lock while main is reading");
+  rw_read_release (rw);
+  msg ("reader: done");
+}
+
+static void
+writer_thread_func (void *rw_)
+{
+  struct rwlock *rw = rw_;
+
+  rw_write_acquire (rw);
+  msg ("writer: got the lock");
+  rw_write_release (rw);
+  msg ("writer: done");
+}
+
+static void
+late_reader_thread_func (void *rw_)
+{
+  struct rwlock *rw = rw_;
+
+  rw_read_acquire (rw);
+  msg ("late reader: got the lock");
+  rw_read_release (rw);
+  msg ("late reader: done");
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-donate-rwlock) begin
+(priority-donate-rwlock) reader: got the lock while main is reading
+(priority-donate-rwlock) reader: done
+(priority-donate-rwlock) This thread should have priority 36.  Actual priority: 36.
+(priority-donate-rwlock) This thread should have priority 36.  Actual priority: 36.
+(priority-donate-rwlock) writer: got the lock
+(priority-donate-rwlock) writer: done
+(priority-donate-rwlock) late reader: got the lock
+(priority-donate-rwlock) late reader: done
+(priority-donate-rwlock) writer, late reader must already have finished, in that order.
+(priority-donate-rwlock) This thread should have priority 31.  Actual priority: 31.
+(priority-donate-rwlock) end
+EOF
+pass;
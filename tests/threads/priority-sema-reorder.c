@@ -0,0 +1,77 @@
+/* Thread "a" acquires a lock and then blocks on a semaphore,
+   followed by a higher-priority thread "b".  Then thread "c",
+   higher than both, blocks acquiring "a"'s lock and donates its
+   priority to "a" while "a" is still waiting on the semaphore.
+   The semaphore must wake "a" first, since it now has the higher
+   priority, and "b" only on the next up. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+struct donate_sema
+  {
+    struct lock lock;
+    struct semaphore sema;
+  };
+
+static thread_func a_thread_func;
+static thread_func b_thread_func;
+static thread_func c_thread_func;
+
+void
+test_priority_sema_reorder (void)
+{
+  struct donate_sema ds;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  lock_init (&ds.lock);
+  sema_init (&ds.sema, 0);
+  thread_create ("a", PRI_DEFAULT + 1, a_thread_func, &ds);
+  thread_create ("b", PRI_DEFAULT + 2, b_thread_func, &ds);
+  thread_create ("c", PRI_DEFAULT + 9, c_thread_func, &ds);
+  msg ("Up the semaphore once.");
+  sema_up (&ds.sema);
+  msg ("Up the semaphore again.");
+  sema_up (&ds.sema);
+  msg ("a, c, b must already have finished.");
+}
+
+static void
+a_thread_func (void *ds_)
+{
+  struct donate_sema *ds = ds_;
+
+  lock_acquire (&ds->lock);
+  sema_down (&ds->sema);
+  msg ("a woke up with priority %d.", thread_get_priority ());
+  lock_release (&ds->lock);
+  msg ("a done.");
+}
+
+static void
+b_thread_func (void *ds_)
+{
+  struct donate_sema *ds = ds_;
+
+  sema_down (&ds->sema);
+  msg ("b woke up with priority %d.", thread_get_priority ());
+}
+
+static void
+c_thread_func (void *ds_)
+{
+  struct donate_sema *ds = ds_;
+
+  lock_acquire (&ds->lock);
+  msg ("c got the lock.");
+  lock_release (&ds->lock);
+  msg ("c done.");
+}
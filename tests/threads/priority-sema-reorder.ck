@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-sema-reorder) begin
+(priority-sema-reorder) Up the semaphore once.
+(priority-sema-reorder) a woke up with priority 40.
+(priority-sema-reorder) c got the lock.
+(priority-sema-reorder) c done.
+(priority-sema-reorder) a done.
+(priority-sema-reorder) Up the semaphore again.
+(priority-sema-reorder) b woke up with priority 33.
+(priority-sema-reorder) a, c, b must already have finished.
+(priority-sema-reorder) end
+EOF
+pass;
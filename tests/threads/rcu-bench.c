@@ -0,0 +1,282 @@
+/* Measures lookup throughput in a small table while a writer
+   keeps replacing its entries, once with readers under RCU and
+   once with readers and the writer sharing a lock.
+
+   READER_CNT threads look keys up for RUN_TICKS timer ticks.  The
+   writer replaces one entry at a time with a new copy and yields.
+   Under RCU the old copy goes to call_rcu(); free() poisons freed
+   blocks, so a reader that saw an entry freed too early would
+   find a bad magic number.  Also checks that every old copy has
+   been freed after rcu_synchronize().
+
+   Finally, one reader stays inside rcu_read_lock() while an entry
+   is handed to call_rcu(); the callback must not run until that
+   reader has left.  The lookup counts are only reported. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/rcu.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define KEY_CNT 32
+#define READER_CNT 4
+#define RUN_TICKS 50
+#define ENTRY_MAGIC 0x52435545
+
+struct entry
+  {
+    struct list_elem elem;
+    int key;
+    int version;
+    unsigned magic;
+    struct rcu_head rcu;
+  };
+
+struct table;
+
+struct reader_info
+  {
+    struct table *table;
+    long long lookups;
+    int bad;                    /* Lookups that found a bad entry. */
+  };
+
+struct table
+  {
+    struct list entries;
+    struct lock lock;           /* Writers; readers too without RCU. */
+    bool use_rcu;
+    volatile bool stop;
+    struct reader_info readers[READER_CNT];
+    int replaced;
+    int freed;
+    struct semaphore done;
+  };
+
+static thread_func reader;
+static thread_func writer;
+static long long run (bool use_rcu);
+static void check_grace_period (void);
+
+void
+test_rcu_bench (void)
+{
+  long long lock_lookups, rcu_lookups;
+
+  lock_lookups = run (false);
+  rcu_lookups = run (true);
+  check_grace_period ();
+  msg ("%d readers, %d ticks: %lld lookups with a lock, %lld with RCU.",
+       READER_CNT, RUN_TICKS, lock_lookups, rcu_lookups);
+  pass ();
+}
+
+static struct table table;
+
+static long long
+run (bool use_rcu)
+{
+  long long lookups = 0;
+  int bad = 0;
+  int i;
+
+  list_init (&table.entries);
+  lock_init (&table.lock);
+  table.use_rcu = use_rcu;
+  table.stop = false;
+  table.replaced = 0;
+  table.freed = 0;
+  sema_init (&table.done, 0);
+
+  for (i = 0; i < KEY_CNT; i++)
+    {
+      struct entry *e = malloc (sizeof *e);
+      ASSERT (e != NULL);
+      e->key = i;
+      e->version = 0;
+      e->magic = ENTRY_MAGIC;
+      list_push_back (&table.entries, &e->elem);
+    }
+
+  for (i = 0; i < READER_CNT; i++)
+    {
+      struct reader_info *r = &table.readers[i];
+      r->table = &table;
+      r->lookups = 0;
+      r->bad = 0;
+      thread_create ("reader", PRI_DEFAULT, reader, r);
+    }
+  thread_create ("writer", PRI_DEFAULT, writer, &table);
+  timer_sleep (RUN_TICKS);
+  table.stop = true;
+  for (i = 0; i < READER_CNT + 1; i++)
+    sema_down (&table.done);
+
+  for (i = 0; i < READER_CNT; i++)
+    {
+      lookups += table.readers[i].lookups;
+      bad += table.readers[i].bad;
+    }
+  if (bad > 0)
+    fail ("%d lookups found a missing or freed entry.", bad);
+  msg ("%s: no lookup found a missing or freed entry.",
+       use_rcu ? "RCU" : "Lock");
+  if (use_rcu)
+    {
+      rcu_synchronize ();
+      if (table.freed != table.replaced)
+        fail ("%d of %d replaced entries freed after a grace period.",
+              table.freed, table.replaced);
+      msg ("RCU: every replaced entry was freed after a grace period.");
+    }
+
+  while (!list_empty (&table.entries))
+    free (list_entry (list_pop_front (&table.entries), struct entry, elem));
+  return lookups;
+}
+
+/* Returns the entry for KEY in T, or a null pointer. */
+static struct entry *
+find (struct table *t, int key)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&t->entries); e != list_end (&t->entries);
+       e = list_next (e))
+    {
+      struct entry *entry = list_entry (e, struct entry, elem);
+      if (entry->key == key)
+        return entry;
+    }
+  return NULL;
+}
+
+static void
+reader (void *r_)
+{
+  struct reader_info *r = r_;
+  struct table *t = r->table;
+  int key = 0;
+
+  while (!t->stop)
+    {
+      struct entry *e;
+
+      if (t->use_rcu)
+        rcu_read_lock ();
+      else
+        lock_acquire (&t->lock);
+      e = find (t, key);
+      if (e == NULL || e->magic != ENTRY_MAGIC || e->key != key)
+        r->bad++;
+      if (t->use_rcu)
+        rcu_read_unlock ();
+      else
+        lock_release (&t->lock);
+
+      r->lookups++;
+      key = (key + 7) % KEY_CNT;
+    }
+  sema_up (&t->done);
+}
+
+static void
+entry_free (struct rcu_head *head)
+{
+  table.freed++;
+  free (rcu_entry (head, struct entry, rcu));
+}
+
+static void
+writer (void *t_)
+{
+  struct table *t = t_;
+  int key = 0;
+
+  while (!t->stop)
+    {
+      struct entry *old, *new;
+
+      new = malloc (sizeof *new);
+      ASSERT (new != NULL);
+
+      lock_acquire (&t->lock);
+      old = find (t, key);
+      ASSERT (old != NULL);
+      memcpy (new, old, sizeof *new);
+      new->version++;
+      rcu_list_insert (&old->elem, &new->elem);
+      list_remove (&old->elem);
+      lock_release (&t->lock);
+
+      t->replaced++;
+      if (t->use_rcu)
+        call_rcu (&old->rcu, entry_free);
+      else
+        {
+          t->freed++;
+          free (old);
+        }
+      key = (key + 1) % KEY_CNT;
+      thread_yield ();
+    }
+  sema_up (&t->done);
+}
+
+/* State shared with the reader in check_grace_period(). */
+static struct semaphore holder_in;      /* Reader is inside. */
+static struct semaphore holder_go;      /* Reader may leave. */
+static struct semaphore holder_out;     /* Reader has left. */
+static bool grace_done;                 /* Callback has run. */
+
+static void
+grace_free (struct rcu_head *head)
+{
+  grace_done = true;
+  free (rcu_entry (head, struct entry, rcu));
+}
+
+static void
+holder (void *aux UNUSED)
+{
+  rcu_read_lock ();
+  sema_up (&holder_in);
+  sema_down (&holder_go);
+  rcu_read_unlock ();
+  sema_up (&holder_out);
+}
+
+/* Hands an entry to call_rcu() while a reader is inside its
+   read-side section and checks that the callback waits for the
+   reader to leave, however many context switches happen first. */
+static void
+check_grace_period (void)
+{
+  struct entry *e = malloc (sizeof *e);
+
+  ASSERT (e != NULL);
+  sema_init (&holder_in, 0);
+  sema_init (&holder_go, 0);
+  sema_init (&holder_out, 0);
+  grace_done = false;
+
+  thread_create ("holder", PRI_DEFAULT, holder, NULL);
+  sema_down (&holder_in);
+  call_rcu (&e->rcu, grace_free);
+  timer_sleep (10);
+  if (grace_done)
+    fail ("callback ran while a reader was inside.");
+  msg ("Callback did not run while a reader was inside.");
+
+  sema_up (&holder_go);
+  sema_down (&holder_out);
+  rcu_synchronize ();
+  if (!grace_done)
+    fail ("callback did not run after the reader left.");
+  msg ("Callback ran after the reader left.");
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+# The lookup counts vary from run to run; they are printed for
+# comparison but not checked.
+our ($test);
+my (@output) = grep (!/^\(rcu-bench\) \d+ readers, \d+ ticks: \d+ lookups with a lock, \d+ with RCU\.$/,
+		     read_text_file ("$test.output"));
+common_checks ("run", @output);
+compare_output ("run", \@output, [<<'EOF']);
+(rcu-bench) begin
+(rcu-bench) Lock: no lookup found a missing or freed entry.
+(rcu-bench) RCU: no lookup found a missing or freed entry.
+(rcu-bench) RCU: every replaced entry was freed after a grace period.
+(rcu-bench) Callback did not run while a reader was inside.
+(rcu-bench) Callback ran after the reader left.
+(rcu-bench) PASS
+(rcu-bench) end
+EOF
+pass;
@@ -0,0 +1,120 @@
+/* Checks that the proportional-share scheduler classes split the
+   CPU between busy threads according to their priorities.
+
+   Four threads at priorities PRI_DEFAULT - 2, PRI_DEFAULT,
+   PRI_DEFAULT + 2 and PRI_DEFAULT + 4 spin for RUN_TICKS ticks.
+   Under -sched=cfs and -sched=stride, a thread's weight grows by
+   about 1.25x per priority level, so they should get roughly 11%,
+   18%, 28% and 43% of the ticks.  Under strict priority only the
+   highest one would run.
+
+   The test fails if a higher-priority thread gets fewer ticks than
+   a lower-priority one, or if any thread gets less than half of
+   its share. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/sched.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 4
+#define RUN_TICKS 500
+
+struct fair_test
+  {
+    volatile bool stop;         /* Set by the main thread to stop. */
+    int64_t ticks[THREAD_CNT];  /* Ticks each spinner got. */
+    struct semaphore done;      /* Upped by each spinner. */
+  };
+
+struct spinner
+  {
+    struct fair_test *test;
+    int id;
+  };
+
+static void test_sched_fair (const char *class);
+static thread_func spinner_thread;
+
+void
+test_sched_fair_cfs (void)
+{
+  test_sched_fair ("cfs");
+}
+
+void
+test_sched_fair_stride (void)
+{
+  test_sched_fair ("stride");
+}
+
+static void
+test_sched_fair (const char *class)
+{
+  static struct fair_test test;
+  struct spinner spinners[THREAD_CNT];
+  int priority[THREAD_CNT];
+  int weight_sum = 0;
+  int64_t tick_sum = 0;
+  int i;
+
+  ASSERT (!thread_mlfqs);
+  if (strcmp (sched_class->name, class))
+    fail ("running under -sched=%s, not -sched=%s.",
+          sched_class->name, class);
+
+  /* Run above the spinners so that we get the CPU back. */
+  thread_set_priority (PRI_MAX);
+
+  test.stop = false;
+  sema_init (&test.done, 0);
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      char name[16];
+
+      priority[i] = PRI_DEFAULT - 2 + 2 * i;
+      weight_sum += sched_weight (priority[i]);
+      spinners[i].test = &test;
+      spinners[i].id = i;
+      snprintf (name, sizeof name, "spinner %d", i);
+      thread_create (name, priority[i], spinner_thread, &spinners[i]);
+    }
+
+  timer_sleep (RUN_TICKS);
+  test.stop = true;
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&test.done);
+
+  for (i = 0; i < THREAD_CNT; i++)
+    tick_sum += test.ticks[i];
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      int64_t share = tick_sum * sched_weight (priority[i]) / weight_sum;
+
+      msg ("Priority %d: %lld ticks, share %lld.",
+           priority[i], test.ticks[i], share);
+      if (test.ticks[i] < share / 2)
+        fail ("priority %d got %lld ticks, less than half its share.",
+              priority[i], test.ticks[i]);
+      if (i > 0 && test.ticks[i] < test.ticks[i - 1])
+        fail ("priority %d got fewer ticks than priority %d.",
+              priority[i], priority[i - 1]);
+    }
+  pass ();
+}
+
+static void
+spinner_thread (void *spinner_)
+{
+  struct spinner *spinner = spinner_;
+  struct fair_test *test = spinner->test;
+
+  while (!test->stop)
+    continue;
+  test->ticks[spinner->id] = thread_current ()->stats.run_ticks;
+  sema_up (&test->done);
+}
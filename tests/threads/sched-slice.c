@@ -0,0 +1,82 @@
+/* Runs a CPU-bound thread and a thread that keeps sleeping with
+   -slice-min=1 -slice-max=16 and checks that the first one ends
+   up with the longest time slice and the second one with the
+   shortest.  Each check prints a fixed line so that the checker
+   can compare the whole transcript. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/sched.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+struct slice_info
+  {
+    struct semaphore done;
+    unsigned slice;                     /* Final t->slice. */
+    struct thread_stats stats;
+  };
+
+static thread_func hog_thread;
+static thread_func sleeper_thread;
+
+void
+test_sched_slice (void)
+{
+  struct slice_info hog, sleeper;
+
+  ASSERT (!thread_mlfqs);
+  if (sched_slice_min != 1 || sched_slice_max != 16)
+    fail ("run with -slice-min=1 -slice-max=16");
+
+  sema_init (&hog.done, 0);
+  sema_init (&sleeper.done, 0);
+  thread_create ("hog", PRI_DEFAULT, hog_thread, &hog);
+  thread_create ("sleeper", PRI_DEFAULT, sleeper_thread, &sleeper);
+  sema_down (&hog.done);
+  sema_down (&sleeper.done);
+
+  if (hog.slice != sched_slice_max)
+    fail ("CPU-bound thread ended with a %u-tick slice.", hog.slice);
+  msg ("CPU-bound thread ended with a %u-tick slice.", sched_slice_max);
+  if (sleeper.slice != sched_slice_min)
+    fail ("sleeping thread ended with a %u-tick slice.", sleeper.slice);
+  msg ("Sleeping thread ended with a %u-tick slice.", sched_slice_min);
+  if (hog.stats.slice_ticks <= (uint64_t) hog.stats.slices * TIME_SLICE)
+    fail ("CPU-bound thread averaged no more than %d ticks.", TIME_SLICE);
+  msg ("CPU-bound thread averaged more than %d ticks per slice.", TIME_SLICE);
+  if (sleeper.stats.slice_ticks >= (uint64_t) sleeper.stats.slices * TIME_SLICE)
+    fail ("sleeping thread averaged no less than %d ticks.", TIME_SLICE);
+  msg ("Sleeping thread averaged less than %d ticks per slice.", TIME_SLICE);
+  pass ();
+}
+
+static void
+finish (struct slice_info *info)
+{
+  info->slice = thread_current ()->slice;
+  thread_get_stats (thread_current (), &info->stats);
+  sema_up (&info->done);
+}
+
+static void
+hog_thread (void *info)
+{
+  int64_t start = timer_ticks ();
+
+  while (timer_elapsed (start) < 100)
+    continue;
+  finish (info);
+}
+
+static void
+sleeper_thread (void *info)
+{
+  int i;
+
+  for (i = 0; i < 20; i++)
+    timer_sleep (1);
+  finish (info);
+}
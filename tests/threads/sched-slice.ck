@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sched-slice) begin
+(sched-slice) CPU-bound thread ended with a 16-tick slice.
+(sched-slice) Sleeping thread ended with a 1-tick slice.
+(sched-slice) CPU-bound thread averaged more than 4 ticks per slice.
+(sched-slice) Sleeping thread averaged less than 4 ticks per slice.
+(sched-slice) PASS
+(sched-slice) end
+EOF
+pass;
@@ -0,0 +1,104 @@
+/* Checks the slab allocator: objects from a cache do not
+   overlap, every object comes out in the state its constructor
+   gave it, that state survives being freed and allocated again,
+   and a second cache can allocate after the first one has given
+   its pages back. */
+
+#include <stdint.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/slab.h"
+
+#define OBJ_CNT 300
+#define OBJ_MAGIC 0x0b1ec7
+
+struct obj
+  {
+    unsigned magic;             /* Set by the constructor. */
+    int id;                     /* Set while allocated. */
+    char pad[32];
+  };
+
+static int ctor_cnt;
+
+static void
+obj_ctor (void *p)
+{
+  struct obj *o = p;
+
+  o->magic = OBJ_MAGIC;
+  o->id = -1;
+  ctor_cnt++;
+}
+
+static struct obj *objs[OBJ_CNT];
+
+static void
+fill (struct kmem_cache *cache)
+{
+  int i;
+
+  for (i = 0; i < OBJ_CNT; i++)
+    {
+      objs[i] = kmem_cache_alloc (cache);
+      if (objs[i] == NULL)
+        fail ("allocating object %d failed", i);
+      if (objs[i]->magic != OBJ_MAGIC || objs[i]->id != -1)
+        fail ("object %d not in constructed state", i);
+      objs[i]->id = i;
+    }
+  for (i = 0; i < OBJ_CNT; i++)
+    if (objs[i]->id != i)
+      fail ("object %d overwritten", i);
+}
+
+static void
+drain (struct kmem_cache *cache)
+{
+  int i;
+
+  for (i = OBJ_CNT - 1; i >= 0; i--)
+    {
+      objs[i]->id = -1;
+      kmem_cache_free (cache, objs[i]);
+    }
+}
+
+void
+test_slab_cache (void)
+{
+  struct kmem_cache *cache = kmem_cache_create ("test", sizeof (struct obj),
+                                                obj_ctor);
+  struct kmem_cache *plain = kmem_cache_create ("test-plain", 24, NULL);
+  uint8_t *p[OBJ_CNT];
+  int ctors, i;
+
+  if (cache == NULL || plain == NULL)
+    fail ("kmem_cache_create failed");
+
+  fill (cache);
+  drain (cache);
+  ctors = ctor_cnt;
+  fill (cache);
+  drain (cache);
+  msg ("constructed objects survive free and reuse.");
+  if (ctor_cnt > ctors * 2)
+    fail ("%d constructor calls for %d objects", ctor_cnt, OBJ_CNT * 2);
+
+  for (i = 0; i < OBJ_CNT; i++)
+    {
+      p[i] = kmem_cache_alloc (plain);
+      if (p[i] == NULL)
+        fail ("allocating plain object %d failed", i);
+      memset (p[i], i, 24);
+    }
+  for (i = 0; i < OBJ_CNT; i++)
+    {
+      int j;
+      for (j = 0; j < 24; j++)
+        if (p[i][j] != (uint8_t) i)
+          fail ("plain object %d overwritten", i);
+      kmem_cache_free (plain, p[i]);
+    }
+  msg ("second cache allocated %d objects.", OBJ_CNT);
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(slab-cache) begin
+(slab-cache) constructed objects survive free and reuse.
+(slab-cache) second cache allocated 300 objects.
+(slab-cache) end
+EOF
+pass;
@@ -0,0 +1,91 @@
+/* Bounces control between two threads with a pair of semaphores
+   and reports the average cost of a context switch.
+
+   Each round trip blocks the main thread in sema_down() and the
+   pong thread in sema_down() once, so it takes exactly two
+   switches as long as nothing else is runnable.
+
+   Each side also counts its half of every round trip and checks,
+   after every switch, that the other side has taken exactly the
+   expected number of steps, so a switch that returns into the wrong thread
+   or loses a callee-saved register shows up as a failure rather
+   than as a suspiciously good cycle count. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "intrinsic.h"
+
+#define ROUND_TRIPS 10000
+
+struct pingpong
+  {
+    struct semaphore ping;      /* Upped by the main thread. */
+    struct semaphore pong;      /* Upped by the pong thread. */
+    int pings;                  /* Round trips started by main. */
+    int pongs;                  /* Round trips answered by pong. */
+    int bad_pings;              /* Pong woke without exactly one new ping. */
+  };
+
+static void pong_thread (void *);
+
+void
+test_switch_pingpong (void)
+{
+  struct pingpong pp;
+  uint64_t start, cycles;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&pp.ping, 0);
+  sema_init (&pp.pong, 0);
+  pp.pings = pp.pongs = pp.bad_pings = 0;
+  thread_create ("pong", PRI_DEFAULT, pong_thread, &pp);
+
+  /* Warm up: let the pong thread start and block. */
+  pp.pings++;
+  sema_up (&pp.ping);
+  sema_down (&pp.pong);
+
+  start = rdtsc ();
+  for (i = 0; i < ROUND_TRIPS; i++)
+    {
+      pp.pings++;
+      sema_up (&pp.ping);
+      sema_down (&pp.pong);
+      if (pp.pongs != pp.pings)
+        fail ("round trip %d: main resumed with %d pongs for %d pings.",
+              i, pp.pongs, pp.pings);
+    }
+  cycles = rdtsc () - start;
+
+  if (pp.bad_pings != 0)
+    fail ("pong thread woke %d times without exactly one new ping.",
+          pp.bad_pings);
+  if (i != ROUND_TRIPS || pp.pongs != ROUND_TRIPS + 1)
+    fail ("main counted %d round trips and pong %d.", i, pp.pongs);
+  msg ("Threads alternated for %d round trips.", ROUND_TRIPS);
+  msg ("%d round trips, %llu cycles per switch.",
+       ROUND_TRIPS, cycles / (2 * ROUND_TRIPS));
+  pass ();
+}
+
+static void
+pong_thread (void *pp_)
+{
+  struct pingpong *pp = pp_;
+  int i;
+
+  for (i = 0; i < ROUND_TRIPS + 1; i++)
+    {
+      sema_down (&pp->ping);
+      if (pp->pings != i + 1)
+        pp->bad_pings++;
+      pp->pongs++;
+      sema_up (&pp->pong);
+    }
+}
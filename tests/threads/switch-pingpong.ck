@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+# The switch cost varies from run to run; it is printed for
+# comparison but not checked.
+our ($test);
+my (@output) = grep (!/^\(switch-pingpong\) \d+ round trips, \d+ cycles per switch\.$/,
+		     read_text_file ("$test.output"));
+common_checks ("run", @output);
+compare_output ("run", \@output, [<<'EOF']);
+(switch-pingpong) begin
+(switch-pingpong) Threads alternated for 10000 round trips.
+(switch-pingpong) PASS
+(switch-pingpong) end
+EOF
+pass;
@@ -0,0 +1,121 @@
+/* Checks sema_down_timeout(), lock_acquire_timeout() and
+   cond_wait_timeout(): each must give up once its timeout has
+   passed, must succeed when woken in time, and a lock waiter
+   that gives up must take back the priority it donated. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+struct timeout_test
+  {
+    struct semaphore sema;
+    struct lock lock;
+    struct condition cond;
+  };
+
+static thread_func sema_thread;
+static thread_func lock_thread;
+static thread_func cond_thread;
+
+void
+test_synch_timeout (void)
+{
+  struct timeout_test tt;
+  int64_t start;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  sema_init (&tt.sema, 0);
+  lock_init (&tt.lock);
+  cond_init (&tt.cond);
+
+  /* Nobody ups the semaphore. */
+  start = timer_ticks ();
+  if (sema_down_timeout (&tt.sema, 5))
+    fail ("sema_down_timeout succeeded on a zero semaphore");
+  if (timer_elapsed (start) < 5)
+    fail ("sema_down_timeout gave up after only %lld ticks",
+          timer_elapsed (start));
+  msg ("sema_down_timeout timed out.");
+
+  /* A lower-priority thread ups it after 2 ticks. */
+  thread_create ("sema", PRI_DEFAULT - 1, sema_thread, &tt);
+  start = timer_ticks ();
+  if (!sema_down_timeout (&tt.sema, 1000))
+    fail ("sema_down_timeout timed out although the semaphore was upped");
+  if (timer_elapsed (start) >= 1000)
+    fail ("sema_down_timeout waited for the whole timeout");
+  msg ("sema_down_timeout got the semaphore.");
+
+  /* A lower-priority thread holds the lock for 20 ticks. */
+  thread_create ("lock", PRI_DEFAULT - 1, lock_thread, &tt);
+  timer_sleep (1);
+  start = timer_ticks ();
+  if (lock_acquire_timeout (&tt.lock, 5))
+    fail ("lock_acquire_timeout got a held lock");
+  if (timer_elapsed (start) < 5)
+    fail ("lock_acquire_timeout gave up after only %lld ticks",
+          timer_elapsed (start));
+  msg ("lock_acquire_timeout timed out.");
+  timer_sleep (30);
+  if (!lock_acquire_timeout (&tt.lock, 1))
+    fail ("lock_acquire_timeout failed on a free lock");
+  msg ("lock_acquire_timeout got the lock.");
+
+  /* Nobody signals. */
+  start = timer_ticks ();
+  if (cond_wait_timeout (&tt.cond, &tt.lock, 5))
+    fail ("cond_wait_timeout was signaled");
+  if (timer_elapsed (start) < 5)
+    fail ("cond_wait_timeout gave up after only %lld ticks",
+          timer_elapsed (start));
+  if (!lock_held_by_current_thread (&tt.lock))
+    fail ("cond_wait_timeout returned without the lock");
+  msg ("cond_wait_timeout timed out.");
+
+  /* A lower-priority thread signals as soon as we wait. */
+  thread_create ("cond", PRI_DEFAULT - 1, cond_thread, &tt);
+  if (!cond_wait_timeout (&tt.cond, &tt.lock, 1000))
+    fail ("cond_wait_timeout timed out although it was signaled");
+  msg ("cond_wait_timeout was signaled.");
+  lock_release (&tt.lock);
+}
+
+static void
+sema_thread (void *tt_)
+{
+  struct timeout_test *tt = tt_;
+
+  timer_sleep (2);
+  sema_up (&tt->sema);
+}
+
+static void
+lock_thread (void *tt_)
+{
+  struct timeout_test *tt = tt_;
+
+  lock_acquire (&tt->lock);
+  timer_sleep (20);
+  msg ("lock holder's priority after the waiter gave up: %d.",
+       thread_get_priority ());
+  lock_release (&tt->lock);
+}
+
+static void
+cond_thread (void *tt_)
+{
+  struct timeout_test *tt = tt_;
+
+  lock_acquire (&tt->lock);
+  cond_signal (&tt->cond, &tt->lock);
+  lock_release (&tt->lock);
+}
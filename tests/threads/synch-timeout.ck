@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(synch-timeout) begin
+(synch-timeout) sema_down_timeout timed out.
+(synch-timeout) sema_down_timeout got the semaphore.
+(synch-timeout) lock_acquire_timeout timed out.
+(synch-timeout) lock holder's priority after the waiter gave up: 30.
+(synch-timeout) lock_acquire_timeout got the lock.
+(synch-timeout) cond_wait_timeout timed out.
+(synch-timeout) cond_wait_timeout was signaled.
+(synch-timeout) end
+EOF
+pass;
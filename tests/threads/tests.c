@@ -17,6 +17,7 @@ static const struct test tests[] =
     {"alarm-priority", test_alarm_priority},
     {"alarm-zero", test_alarm_zero},
     {"alarm-negative", test_alarm_negative},
+    {"alarm-stress", test_alarm_stress},
     {"priority-change", test_priority_change},
     {"priority-donate-one", test_priority_donate_one},
     {"priority-donate-multiple", test_priority_donate_multiple},
@@ -25,6 +26,20 @@ static const struct test tests[] =
     {"priority-donate-sema", test_priority_donate_sema},
     {"priority-donate-lower", test_priority_donate_lower},
     {"priority-donate-chain", test_priority_donate_chain},
+    {"switch-pingpong", test_switch_pingpong},
+    {"priority-donate-bench", test_priority_donate_bench},
+    {"sched-fair-cfs", test_sched_fair_cfs},
+    {"sched-fair-stride", test_sched_fair_stride},
+    {"workqueue", test_workqueue},
+    {"sched-slice", test_sched_slice},
+    {"priority-donate-rwlock", test_priority_donate_rwlock},
+    {"priority-sema-reorder", test_priority_sema_reorder},
+    {"synch-timeout", test_synch_timeout},
+    {"rcu-bench", test_rcu_bench},
+    {"palloc-buddy", test_palloc_buddy},
+    {"palloc-zero", test_palloc_zero},
+    {"directmap-bench", test_directmap_bench},
+    {"slab-cache", test_slab_cache},
     {"priority-fifo", test_priority_fifo},
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
@@ -38,6 +53,7 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"mlfqs-overhead", test_mlfqs_overhead},
   };
 
 static const char *test_name;
@@ -0,0 +1,110 @@
+/* Runs immediate and delayed work through a workqueue and checks
+   that every item runs exactly once, that delayed items do not
+   run before their deadline and run in deadline order, that the
+   pool grows beyond one
+   worker when the work blocks without exceeding its limit, and
+   that wq_flush() waits for all of it. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "devices/timer.h"
+
+#define WORK_CNT 20
+#define DELAYED_CNT 5
+#define MAX_WORKERS 4
+
+struct item
+  {
+    struct work work;
+    int runs;                   /* Times this item ran. */
+    int64_t due;                /* Earliest tick it may run, or 0. */
+    bool early;                 /* Ran before DUE. */
+    int order;                  /* Delayed items: position in run order. */
+  };
+
+static int running;             /* Items running right now. */
+static int max_running;         /* Most items seen running at once. */
+static int delayed_started;     /* Delayed items started so far. */
+
+static work_func run_item;
+
+void
+test_workqueue (void)
+{
+  static struct item items[WORK_CNT + DELAYED_CNT];
+  struct workqueue *wq;
+  int i;
+
+  wq = wq_create ("wq-test", PRI_DEFAULT, MAX_WORKERS);
+  if (wq == NULL)
+    fail ("wq_create failed.");
+
+  for (i = 0; i < WORK_CNT + DELAYED_CNT; i++)
+    work_init (&items[i].work);
+
+  for (i = 0; i < WORK_CNT; i++)
+    if (!wq_queue (wq, &items[i].work, run_item, &items[i]))
+      fail ("wq_queue refused idle item %d.", i);
+  for (i = WORK_CNT; i < WORK_CNT + DELAYED_CNT; i++)
+    {
+      int64_t delay = 10 * (i - WORK_CNT + 1);
+      items[i].due = timer_ticks () + delay;
+      if (!wq_queue_delayed (wq, &items[i].work, run_item, &items[i], delay))
+        fail ("wq_queue_delayed refused idle item %d.", i);
+    }
+  if (wq_queue_delayed (wq, &items[WORK_CNT].work, run_item,
+                        &items[WORK_CNT], 1))
+    fail ("wq_queue_delayed accepted a pending item.");
+
+  wq_flush (wq);
+  msg ("Flushed %d immediate and %d delayed items.", WORK_CNT, DELAYED_CNT);
+
+  for (i = 0; i < WORK_CNT + DELAYED_CNT; i++)
+    {
+      if (items[i].runs != 1)
+        fail ("item %d ran %d times.", i, items[i].runs);
+      if (items[i].early)
+        fail ("delayed item %d ran before its deadline.", i);
+    }
+  if (max_running < 2 || max_running > MAX_WORKERS)
+    fail ("%d items ran at once with at most %d workers.",
+          max_running, MAX_WORKERS);
+  msg ("Every item ran once, none early.");
+  msg ("Between 2 and %d items ran at once.", MAX_WORKERS);
+  for (i = WORK_CNT; i < WORK_CNT + DELAYED_CNT; i++)
+    if (items[i].order != i - WORK_CNT)
+      fail ("delayed item %d ran in position %d.", i, items[i].order);
+  msg ("Delayed items ran in deadline order.");
+  pass ();
+}
+
+/* Work function: counts the run and blocks for a tick so that
+   the workqueue has to add workers to keep up. */
+static void
+run_item (void *item_)
+{
+  struct item *item = item_;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  item->runs++;
+  if (item->due != 0)
+    {
+      if (timer_ticks () < item->due)
+        item->early = true;
+      item->order = delayed_started++;
+    }
+  if (++running > max_running)
+    max_running = running;
+  intr_set_level (old_level);
+
+  timer_sleep (1);
+
+  old_level = intr_disable ();
+  running--;
+  intr_set_level (old_level);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue) begin
+(workqueue) Flushed 20 immediate and 5 delayed items.
+(workqueue) Every item ran once, none early.
+(workqueue) Between 2 and 4 items ran at once.
+(workqueue) Delayed items ran in deadline order.
+(workqueue) PASS
+(workqueue) end
+EOF
+pass;
@@ -0,0 +1,69 @@
+/* Runs floating-point work in several processes at once and
+   checks that none of them sees another one's FPU registers.
+
+   Each process keeps a running sum in %xmm0 for many iterations,
+   long enough to be preempted several times, so its registers
+   only survive if they are saved and restored across context
+   switches.  User programs are built with -mno-sse, so the SSE
+   instructions are written in inline assembly. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 4
+#define ITERATIONS 20000000
+
+/* Sets %xmm0 to SEED and adds 1.0 to it ITERATIONS times, then
+   returns the result converted back to an integer.  All values
+   stay below 2**53, so the double arithmetic is exact. */
+static long
+fp_work (long seed)
+{
+  long iterations = ITERATIONS;
+  long one = 1;
+  long result;
+
+  asm volatile ("cvtsi2sdq %2, %%xmm0\n\t"
+                "cvtsi2sdq %3, %%xmm1\n"
+                "1:\n\t"
+                "addsd %%xmm1, %%xmm0\n\t"
+                "decq %1\n\t"
+                "jnz 1b\n\t"
+                "cvttsd2siq %%xmm0, %0"
+                : "=r" (result), "+r" (iterations)
+                : "r" (seed), "r" (one)
+                : "cc");
+  return result;
+}
+
+void
+test_main (void) 
+{
+  pid_t children[CHILD_CNT];
+  long seed;
+  int i;
+
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      seed = (i + 1) * 100000000L;
+      children[i] = fork ("child");
+      if (children[i] == 0)
+        exit (fp_work (seed) == seed + ITERATIONS ? 0 : 1);
+      if (children[i] < 0)
+        fail ("fork() returned %d", children[i]);
+    }
+
+  seed = 7;
+  if (fp_work (seed) != seed + ITERATIONS)
+    fail ("parent FPU state was corrupted");
+  msg ("parent: FPU state intact");
+
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      int status = wait (children[i]);
+      if (status != 0)
+        fail ("child %d: FPU state was corrupted (status %d)", i, status);
+      msg ("child %d: FPU state intact", i);
+    }
+}
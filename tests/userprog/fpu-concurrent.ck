@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fpu-concurrent) begin
+(fpu-concurrent) parent: FPU state intact
+(fpu-concurrent) child 0: FPU state intact
+(fpu-concurrent) child 1: FPU state intact
+(fpu-concurrent) child 2: FPU state intact
+(fpu-concurrent) child 3: FPU state intact
+(fpu-concurrent) end
+EOF
+pass;
@@ -0,0 +1,140 @@
+/* Benchmarks the futex-based uthread mutex.  Measures the cost of
+   an uncontended lock/unlock pair, which must stay in user mode,
+   and of the same pair when several threads fight over one lock,
+   then runs a bounded buffer on a condition variable.  The
+   cycle counts are informational; correctness is checked. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include <uthread.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define THREADS 4
+#define ITERS 2000
+#define ITEMS 500
+#define SLOTS 4
+
+static struct uthread_mutex mutex = UTHREAD_MUTEX_INITIALIZER;
+static volatile int counter;
+
+static inline uint64_t
+rdtsc (void)
+{
+  uint32_t lo, hi;
+  asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+}
+
+/* Increments COUNTER ITERS times, holding MUTEX across a short
+   delay so that timer preemption often lands inside it. */
+static int
+contender (void *aux UNUSED)
+{
+  int i, j;
+
+  for (i = 0; i < ITERS; i++)
+    {
+      uthread_mutex_lock (&mutex);
+      counter++;
+      for (j = 0; j < 100; j++)
+        asm volatile ("");
+      uthread_mutex_unlock (&mutex);
+    }
+  return 0;
+}
+
+/* Bounded buffer. */
+static struct uthread_mutex buf_lock = UTHREAD_MUTEX_INITIALIZER;
+static struct uthread_cond not_empty = UTHREAD_COND_INITIALIZER;
+static struct uthread_cond not_full = UTHREAD_COND_INITIALIZER;
+static int buf[SLOTS], head, tail, used;
+
+static int
+producer (void *aux UNUSED)
+{
+  int i;
+
+  for (i = 1; i <= ITEMS + 1; i++)
+    {
+      uthread_mutex_lock (&buf_lock);
+      while (used == SLOTS)
+        uthread_cond_wait (&not_full, &buf_lock);
+      /* Item ITEMS + 1 is 0 and tells the consumer to stop. */
+      buf[head++ % SLOTS] = i <= ITEMS ? i : 0;
+      used++;
+      uthread_cond_signal (&not_empty);
+      uthread_mutex_unlock (&buf_lock);
+    }
+  return 0;
+}
+
+static int
+consumer (void *aux UNUSED)
+{
+  int sum = 0;
+
+  for (;;)
+    {
+      int item;
+
+      uthread_mutex_lock (&buf_lock);
+      while (used == 0)
+        uthread_cond_wait (&not_empty, &buf_lock);
+      item = buf[tail++ % SLOTS];
+      used--;
+      uthread_cond_signal (&not_full);
+      uthread_mutex_unlock (&buf_lock);
+      if (item == 0)
+        return sum;
+      sum += item;
+    }
+}
+
+void
+test_main (void)
+{
+  tid_t tids[THREADS], prod, cons;
+  uint64_t start, cycles;
+  int i;
+
+  /* Uncontended. */
+  start = rdtsc ();
+  for (i = 0; i < THREADS * ITERS; i++)
+    {
+      uthread_mutex_lock (&mutex);
+      counter++;
+      uthread_mutex_unlock (&mutex);
+    }
+  cycles = rdtsc () - start;
+  if (mutex.contended != 0)
+    fail ("uncontended lock waited %u times", mutex.contended);
+  msg ("uncontended lock stayed in user mode");
+  msg ("uncontended: %llu cycles per lock/unlock",
+       cycles / (THREADS * ITERS));
+
+  /* Contended. */
+  counter = 0;
+  start = rdtsc ();
+  for (i = 0; i < THREADS; i++)
+    CHECK ((tids[i] = uthread_create (contender, NULL)) != TID_ERROR,
+           "start contender %d", i);
+  for (i = 0; i < THREADS; i++)
+    uthread_join (tids[i]);
+  cycles = rdtsc () - start;
+  if (counter != THREADS * ITERS)
+    fail ("counter is %d, expected %d", counter, THREADS * ITERS);
+  msg ("contended counter is correct");
+  msg ("contended: %llu cycles per lock/unlock, %u of %d waited",
+       cycles / (THREADS * ITERS), mutex.contended, THREADS * ITERS);
+
+  /* Condition variables. */
+  CHECK ((cons = uthread_create (consumer, NULL)) != TID_ERROR,
+         "start consumer");
+  CHECK ((prod = uthread_create (producer, NULL)) != TID_ERROR,
+         "start producer");
+  uthread_join (prod);
+  if (uthread_join (cons) != ITEMS * (ITEMS + 1) / 2)
+    fail ("consumer got the wrong items");
+  msg ("consumer got every item");
+}
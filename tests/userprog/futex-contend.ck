@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+# The benchmark also prints cycle counts, which vary from run to run.
+@output = get_core_output ("run", @output);
+foreach my $want ('(futex-contend) begin',
+                  '(futex-contend) uncontended lock stayed in user mode',
+                  '(futex-contend) contended counter is correct',
+                  '(futex-contend) consumer got every item',
+                  '(futex-contend) end',
+                  'futex-contend: exit(0)') {
+  fail "missing \"$want\" in output" unless grep ($_ eq $want, @output);
+}
+pass;
@@ -0,0 +1,24 @@
+/* Reads the scheduling statistics of the running process twice,
+   spinning in between, and checks that its run time grows. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct thread_stats before, after;
+  volatile int i;
+
+  CHECK (threadstats (&before), "threadstats");
+  for (i = 0; i < 1000000; i++)
+    continue;
+  CHECK (threadstats (&after), "threadstats");
+
+  if (after.run_cycles <= before.run_cycles)
+    fail ("run time did not grow");
+  if (after.run_ticks < before.run_ticks)
+    fail ("run ticks went backwards");
+  msg ("run time grew");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-stats) begin
+(thread-stats) threadstats
+(thread-stats) threadstats
+(thread-stats) run time grew
+(thread-stats) end
+thread-stats: exit(0)
+EOF
+pass;
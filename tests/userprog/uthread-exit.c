@@ -0,0 +1,59 @@
+/* Calls exit() from a thread other than the initial one in a
+   forked child, while the initial thread is blocked in
+   futex_wait() and another thread spins.  Checks that the whole
+   child ends and that wait() returns the status passed to exit().
+   Then returns from the initial thread while another thread is
+   still blocked, which must end the process as well. */
+
+#include <debug.h>
+#include <syscall.h>
+#include <uthread.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Nobody ever calls futex_wake() on this. */
+static int never;
+
+static int
+block (void *aux UNUSED)
+{
+  futex_wait (&never, 0);
+  return 1;
+}
+
+static int
+spin (void *aux UNUSED)
+{
+  volatile int x = 0;
+
+  for (;;)
+    x++;
+  NOT_REACHED ();
+}
+
+static int
+quit (void *aux UNUSED)
+{
+  exit (57);
+}
+
+void
+test_main (void)
+{
+  pid_t pid;
+
+  pid = fork ("child");
+  if (pid == 0)
+    {
+      if (uthread_create (block, NULL) == TID_ERROR
+          || uthread_create (spin, NULL) == TID_ERROR
+          || uthread_create (quit, NULL) == TID_ERROR)
+        fail ("uthread_create failed");
+      futex_wait (&never, 0);
+      fail ("initial thread kept running after exit()");
+    }
+  if (pid < 0)
+    fail ("fork failed");
+  msg ("child exit status is %d", wait (pid));
+  CHECK (uthread_create (block, NULL) != TID_ERROR, "create blocked thread");
+}
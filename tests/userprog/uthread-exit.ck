@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(uthread-exit) begin
+child: exit(57)
+(uthread-exit) child exit status is 57
+(uthread-exit) create blocked thread
+(uthread-exit) end
+uthread-exit: exit(0)
+EOF
+pass;
@@ -0,0 +1,80 @@
+/* Starts several threads that sum parts of a shared array and
+   one that reads a file opened by the initial thread, then joins
+   them all.  Checks that the threads share memory and file
+   descriptors and that exit statuses come back through join. */
+
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include <uthread.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define WORKERS 4
+#define NUMBERS 1000
+
+static int numbers[NUMBERS];
+static int sums[WORKERS];
+
+static int
+sum_part (void *idx_)
+{
+  int idx = (int) (intptr_t) idx_;
+  int i;
+
+  for (i = idx; i < NUMBERS; i += WORKERS)
+    sums[idx] += numbers[i];
+  return idx + 10;
+}
+
+static int
+read_sample (void *fd_)
+{
+  int fd = (int) (intptr_t) fd_;
+  char buf[sizeof sample - 1];
+
+  if (read (fd, buf, sizeof buf) != (int) sizeof buf)
+    return -1;
+  return memcmp (buf, sample, sizeof buf) == 0;
+}
+
+void
+test_main (void)
+{
+  tid_t tids[WORKERS], reader;
+  int total, i, fd;
+
+  for (i = 0; i < NUMBERS; i++)
+    numbers[i] = i;
+
+  for (i = 0; i < WORKERS; i++)
+    {
+      tids[i] = uthread_create (sum_part, (void *) (intptr_t) i);
+      if (tids[i] == TID_ERROR)
+        fail ("uthread_create %d failed", i);
+    }
+  total = 0;
+  for (i = 0; i < WORKERS; i++)
+    {
+      int status = uthread_join (tids[i]);
+      if (status != i + 10)
+        fail ("thread %d exited with %d, expected %d", i, status, i + 10);
+      total += sums[i];
+    }
+  if (total != NUMBERS * (NUMBERS - 1) / 2)
+    fail ("threads summed to %d", total);
+  msg ("threads summed the shared array");
+
+  if (uthread_join (tids[0]) != -1)
+    fail ("joined the same thread twice");
+
+  CHECK ((fd = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  reader = uthread_create (read_sample, (void *) (intptr_t) fd);
+  if (reader == TID_ERROR)
+    fail ("uthread_create failed");
+  if (uthread_join (reader) != 1)
+    fail ("thread could not read the shared file descriptor");
+  msg ("thread read the shared file descriptor");
+  close (fd);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(uthread-join) begin
+(uthread-join) threads summed the shared array
+(uthread-join) open "sample.txt"
+(uthread-join) thread read the shared file descriptor
+(uthread-join) end
+uthread-join: exit(0)
+EOF
+pass;
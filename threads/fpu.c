@@ -0,0 +1,237 @@
+#include "threads/fpu.h"
+#include <debug.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+
+/* Lazy FPU context switching.
+
+   x87/SSE/AVX 레지스터는 intr_frame에 들어있지 않으므로 스레드를 바꿀 때
+   저장되지 않는다.  매번 XSAVE/XRSTOR 하는 대신, 레지스터에 들어있는 상태의
+   주인(fpu_owner)을 기억해두고 다른 스레드로 바꿀 때는 CR0.TS만 켠다.
+   TS가 켜진 상태에서 FPU 명령을 쓰면 #NM이 나고, 그때서야 주인의 상태를
+   저장하고 현재 스레드의 상태를 복원한다.  그래서 FPU를 한 번도 안 쓰는
+   스레드는 저장 공간도, 저장/복원 비용도 들지 않는다.
+
+   스레드별 저장 공간(fpu_area)은 처음 #NM이 났을 때 페이지 하나를 받는다.
+   커널 자신은 -mno-sse로 빌드되므로 FPU를 쓰는 것은 유저 프로그램뿐이다. */
+
+#define CR0_MP (1 << 1)             /* Monitor coprocessor. */
+#define CR0_EM (1 << 2)             /* x87 emulation. */
+#define CR0_TS (1 << 3)             /* Task switched. */
+#define CR4_OSFXSR (1 << 9)         /* FXSAVE/FXRSTOR and SSE enabled. */
+#define CR4_OSXMMEXCPT (1 << 10)    /* Unmasked SSE exceptions raise #XF. */
+#define CR4_OSXSAVE (1 << 18)       /* XSAVE and XCR0 enabled. */
+
+#define CPUID_1_ECX_XSAVE (1 << 26) /* CPUID.1:ECX, XSAVE supported. */
+#define XCR0_X87 (1 << 0)
+#define XCR0_SSE (1 << 1)
+#define XCR0_AVX (1 << 2)
+
+#define FXSAVE_SIZE 512             /* FXSAVE 영역 크기 */
+#define FCW_INIT 0x037f             /* FNINIT 직후의 x87 control word */
+#define MXCSR_INIT 0x1f80           /* 모든 SSE 예외가 masked된 MXCSR */
+
+static bool use_xsave;              /* XSAVE를 쓸지, 아니면 FXSAVE */
+static uint64_t xsave_mask;         /* XCR0에 켠 상태 구성요소 */
+static size_t fpu_size;             /* 저장 영역 크기 */
+static bool ts_set;                 /* CR0.TS가 켜져 있는지 */
+
+/* 지금 FPU 레지스터에 상태가 들어있는 스레드, 없으면 NULL */
+static struct thread *fpu_owner;
+
+/* Statistics. */
+static long long fpu_traps;         /* #NM 횟수 */
+static long long fpu_saves;         /* 다른 스레드의 상태를 저장한 횟수 */
+
+static intr_handler_func fpu_trap;
+
+static void
+set_ts (void) {
+	if (!ts_set) {
+		lcr0 (rcr0 () | CR0_TS);
+		ts_set = true;
+	}
+}
+
+static void
+clear_ts (void) {
+	if (ts_set) {
+		clts ();
+		ts_set = false;
+	}
+}
+
+/* 레지스터의 FPU 상태를 AREA에 저장 */
+static void
+fpu_save (void *area) {
+	if (use_xsave)
+		__asm __volatile ("xsave64 (%0)"
+				:: "r" (area), "a" ((uint32_t) xsave_mask),
+				"d" ((uint32_t) (xsave_mask >> 32)) : "memory");
+	else
+		__asm __volatile ("fxsave64 (%0)" :: "r" (area) : "memory");
+}
+
+/* AREA의 FPU 상태를 레지스터로 복원 */
+static void
+fpu_restore (const void *area) {
+	if (use_xsave)
+		__asm __volatile ("xrstor64 (%0)"
+				:: "r" (area), "a" ((uint32_t) xsave_mask),
+				"d" ((uint32_t) (xsave_mask >> 32)) : "memory");
+	else
+		__asm __volatile ("fxrstor64 (%0)" :: "r" (area) : "memory");
+}
+
+/* SSE와 (지원하면) XSAVE를 켜고 #NM 핸들러를 등록한다.
+   처음에는 아무도 FPU 주인이 아니므로 TS를 켜둔다. */
+void
+fpu_init (void) {
+	uint32_t eax, ebx, ecx, edx;
+	uint64_t cr4;
+
+	cpuid (1, 0, &eax, &ebx, &ecx, &edx);
+	cr4 = rcr4 () | CR4_OSFXSR | CR4_OSXMMEXCPT;
+	use_xsave = (ecx & CPUID_1_ECX_XSAVE) != 0;
+	if (use_xsave)
+		cr4 |= CR4_OSXSAVE;
+	lcr4 (cr4);
+
+	fpu_size = FXSAVE_SIZE;
+	if (use_xsave) {
+		/* CPUID.(0DH,0):EAX = 지원되는 구성요소, EBX = XCR0에 켠 구성요소의 영역 크기 */
+		cpuid (0xd, 0, &eax, &ebx, &ecx, &edx);
+		xsave_mask = eax & (XCR0_X87 | XCR0_SSE | XCR0_AVX);
+		xsetbv (0, xsave_mask);
+		cpuid (0xd, 0, &eax, &ebx, &ecx, &edx);
+		fpu_size = ebx;
+	}
+	ASSERT (fpu_size <= PGSIZE);
+
+	lcr0 ((rcr0 () & ~CR0_EM) | CR0_MP | CR0_TS);
+	ts_set = true;
+
+	intr_register_int (7, 0, INTR_OFF, fpu_trap,
+			"#NM Device Not Available Exception");
+}
+
+/* schedule()에서 NEXT로 전환하기 직전에 인터럽트가 꺼진 상태로 호출.
+   NEXT가 레지스터의 주인이면 그대로 쓰게 하고, 아니면 TS를 켜서
+   처음 FPU를 쓸 때 #NM이 나게 한다. */
+void
+fpu_switch (struct thread *next) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (next == fpu_owner)
+		clear_ts ();
+	else
+		set_ts ();
+}
+
+/* 종료하는 스레드 T가 레지스터의 주인이면 주인을 없앤다.
+   저장 공간은 struct thread 페이지와 함께 해제된다. */
+void
+fpu_exit (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (fpu_owner == t)
+		fpu_owner = NULL;
+}
+
+/* fork: SRC의 FPU 상태를 DST에 복사한다.  메모리가 없으면 false. */
+bool
+fpu_fork (struct thread *dst, struct thread *src) {
+	enum intr_level old_level;
+	void *area;
+
+	if (src->fpu_area == NULL)
+		return true;
+	area = palloc_get_page (0);
+	if (area == NULL)
+		return false;
+
+	old_level = intr_disable ();
+	if (fpu_owner == src) {
+		/* SRC의 최신 상태는 레지스터에 있으니 먼저 저장해둔다. */
+		clear_ts ();
+		fpu_save (src->fpu_area);
+		fpu_saves++;
+		fpu_owner = NULL;
+		set_ts ();
+	}
+	memcpy (area, src->fpu_area, fpu_size);
+	dst->fpu_area = area;
+	intr_set_level (old_level);
+	return true;
+}
+
+/* exec, exit: T의 FPU 상태를 버린다.  다음에 FPU를 쓰면 초기 상태로 시작한다. */
+void
+fpu_release (struct thread *t) {
+	enum intr_level old_level = intr_disable ();
+	void *area = t->fpu_area;
+
+	if (fpu_owner == t) {
+		fpu_owner = NULL;
+		set_ts ();
+	}
+	t->fpu_area = NULL;
+	intr_set_level (old_level);
+
+	if (area != NULL)
+		palloc_free_page (area);
+}
+
+/* Prints FPU statistics. */
+void
+fpu_print_stats (void) {
+	printf ("FPU: %s, %lld #NM traps, %lld lazy saves\n",
+			use_xsave ? "xsave" : "fxsave", fpu_traps, fpu_saves);
+}
+
+/* #NM: TS가 켜진 상태에서 FPU 명령을 실행했다.
+   이전 주인의 상태를 저장하고 현재 스레드의 상태를 복원한다.
+   INTR_OFF로 등록했으므로 처음부터 끝까지 인터럽트가 꺼져 있고,
+   palloc도 잠들지 않으므로 그 사이 fpu_owner가 바뀌지 않는다. */
+static void
+fpu_trap (struct intr_frame *f UNUSED) {
+	struct thread *curr = thread_current ();
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	fpu_traps++;
+	if (curr->fpu_area == NULL) {
+		/* 처음 FPU를 쓰는 스레드: 초기 상태를 담은 저장 공간을 만든다.
+		   FXRSTOR는 FCW와 MXCSR을 legacy 영역에서 읽고, XRSTOR는 header가
+		   0이면 x87/AVX를 초기 상태로 만들고 MXCSR만 legacy 영역에서 읽는다. */
+		uint8_t *area = palloc_get_page (PAL_ZERO);
+		if (area == NULL) {
+			printf ("%s: out of memory for FPU state\n", curr->name);
+#ifdef USERPROG
+			curr->exit_status = -1;
+#endif
+			thread_exit ();
+		}
+		*(uint16_t *) (area + 0) = FCW_INIT;
+		*(uint32_t *) (area + 24) = MXCSR_INIT;
+		curr->fpu_area = area;
+	}
+
+	/* fpu_switch()가 주인에게는 TS를 꺼주므로 주인은 보통 다른 스레드지만
+	   fpu_owner를 믿기 전에 한 번 더 확인한다. */
+	clear_ts ();
+	if (fpu_owner == curr)
+		return;
+	if (fpu_owner != NULL) {
+		fpu_save (fpu_owner->fpu_area);
+		fpu_saves++;
+	}
+	fpu_restore (curr->fpu_area);
+	fpu_owner = curr;
+}
@@ -1,6 +1,7 @@
 #include "threads/init.h"
 #include <console.h>
 #include <debug.h>
+#include <inttypes.h>
 #include <limits.h>
 #include <random.h>
 #include <stddef.h>
@@ -13,14 +14,19 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "devices/vga.h"
+#include "threads/fpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/mmu.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/pte.h"
+#include "threads/rcu.h"
+#include "threads/sched.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -51,6 +57,9 @@ bool power_off_when_done;
 
 bool thread_tests;
 
+/* top: Print per-thread scheduling statistics at power off? */
+static bool print_top;
+
 static void bss_init (void);
 static void paging_init (uint64_t mem_end);
 
@@ -80,11 +89,13 @@ main (void) {
 	/* Initialize ourselves as a thread so we can use locks,
 	   then enable console locking. */
 	thread_init ();
+	wq_init ();
 	console_init ();
 
 	/* Initialize memory system. */
 	mem_end = palloc_init ();
 	malloc_init ();
+	kmem_init ();
 	paging_init (mem_end);
 
 #ifdef USERPROG
@@ -94,15 +105,18 @@ main (void) {
 
 	/* Initialize interrupt handlers. */
 	intr_init ();
+	fpu_init ();
 	timer_init ();
 	kbd_init ();
 	input_init ();
 #ifdef USERPROG
 	exception_init ();
 	syscall_init ();
+	process_cache_init ();
 #endif
 	/* Start thread scheduler and enable interrupts. */
 	thread_start ();
+	rcu_init ();
 	serial_init_queue ();
 	timer_calibrate ();
 
@@ -142,29 +156,56 @@ bss_init (void) {
 
 /* Populates the page table with the kernel virtual mapping,
  * and then sets up the CPU to use the new page directory.
- * Points base_pml4 to the pml4 it creates. */
+ * Points base_pml4 to the pml4 it creates.
+ *
+ * 2 MB 단위로 통째로 들어가는 구간은 PTE_PS가 켜진 PDE 하나로 매핑해서
+ * 페이지 테이블과 TLB 항목을 아낀다.  커널 코드가 걸친 구간은 읽기 전용
+ * 권한을 4 kB 단위로 줘야 하므로, 그리고 mem_end 끝자락은 2 MB가 안 되므로
+ * 예전처럼 4 kB PTE로 매핑한다.  KERN_BASE가 1 GB 정렬이 아니라서
+ * (0x8004000000) 1 GB 페이지는 쓸 수 없다. */
 static void
 paging_init (uint64_t mem_end) {
 	uint64_t *pml4, *pte;
 	int perm;
+	size_t large_cnt = 0, small_cnt = 0;
 	pml4 = base_pml4 = palloc_get_page (PAL_ASSERT | PAL_ZERO);
 
 	extern char start, _end_kernel_text;
+	uint64_t text_start = vtop (&start);
+	uint64_t text_end = vtop (&_end_kernel_text);
+
 	// Maps physical address [0 ~ mem_end] to
 	//   [LOADER_KERN_BASE ~ LOADER_KERN_BASE + mem_end].
-	for (uint64_t pa = 0; pa < mem_end; pa += PGSIZE) {
+	for (uint64_t pa = 0; pa < mem_end; ) {
 		uint64_t va = (uint64_t) ptov(pa);
 
+		if (pa % LARGE_PGSIZE == 0 && pa + LARGE_PGSIZE <= mem_end
+				&& (pa + LARGE_PGSIZE <= text_start || pa >= text_end)) {
+			uint64_t *pde = pml4_pde_walk (pml4, va, 1);
+			if (pde == NULL)
+				PANIC ("paging_init: out of memory mapping %#"PRIx64, pa);
+			*pde = pa | PTE_P | PTE_W | PTE_PS;
+			large_cnt++;
+			pa += LARGE_PGSIZE;
+			continue;
+		}
+
 		perm = PTE_P | PTE_W;
-		if ((uint64_t) &start <= va && va < (uint64_t) &_end_kernel_text)
+		if (text_start <= pa && pa < text_end)
 			perm &= ~PTE_W;
 
-		if ((pte = pml4e_walk (pml4, va, 1)) != NULL)
-			*pte = pa | perm;
+		if ((pte = pml4e_walk (pml4, va, 1)) == NULL)
+			PANIC ("paging_init: out of memory mapping %#"PRIx64, pa);
+		*pte = pa | perm;
+		small_cnt++;
+		pa += PGSIZE;
 	}
+	printf ("Direct map: %zu 2 MB pages, %zu 4 kB pages\n",
+			large_cnt, small_cnt);
 
 	// reload cr3
 	pml4_activate(0);
+	palloc_paging_ready ();
 }
 
 /* Breaks the kernel command line into words and returns them as
@@ -221,6 +262,19 @@ parse_options (char **argv) {
 			random_init (atoi (value));
 		else if (!strcmp (name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp (name, "-sched")) {
+			if (value == NULL || !sched_select (value))
+				PANIC ("unknown scheduler class `%s' (use -h for help)",
+						value != NULL ? value : "");
+		}
+		else if (!strcmp (name, "-slice-min"))
+			sched_slice_min = atoi (value);
+		else if (!strcmp (name, "-slice-max"))
+			sched_slice_max = atoi (value);
+		else if (!strcmp (name, "-tickless"))
+			timer_tickless = true;
+		else if (!strcmp (name, "-zero-threads"))
+			thread_zero_pages = true;
 #ifdef USERPROG
 		else if (!strcmp (name, "-ul"))
 			user_page_limit = atoi (value);
@@ -252,6 +306,20 @@ run_task (char **argv) {
 	printf ("Execution of '%s' complete.\n", task);
 }
 
+/* Arms the per-thread statistics table printed at power off. */
+static void
+run_top (char **argv UNUSED) {
+	print_top = true;
+}
+
+#ifdef LOCKSTAT
+/* Prints lock contention statistics gathered so far. */
+static void
+run_lockstat (char **argv UNUSED) {
+	lockstat_print ();
+}
+#endif
+
 /* Executes all of the actions specified in ARGV[]
    up to the null pointer sentinel. */
 static void
@@ -266,6 +334,10 @@ run_actions (char **argv) {
 	/* Table of supported actions. */
 	static const struct action actions[] = {
 		{"run", 2, run_task},
+		{"top", 1, run_top},
+#ifdef LOCKSTAT
+		{"lockstat", 1, run_lockstat},
+#endif
 #ifdef FILESYS
 		{"ls", 1, fsutil_ls},
 		{"cat", 2, fsutil_cat},
@@ -311,6 +383,10 @@ usage (void) {
 			"  run 'PROG [ARG...]' Run PROG and wait for it to complete.\n"
 #else
 			"  run TEST           Run TEST.\n"
+#endif
+			"  top                Print per-thread scheduling statistics at power off.\n"
+#ifdef LOCKSTAT
+			"  lockstat           Print lock contention statistics now.\n"
 #endif
 #ifdef FILESYS
 			"  ls                 List files in the root directory.\n"
@@ -326,6 +402,14 @@ usage (void) {
 			"  -f                 Format file system disk during startup.\n"
 			"  -rs=SEED           Set random number seed to SEED.\n"
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
+			"  -sched=NAME        Use scheduler class NAME: priority (default),\n"
+			"                     cfs (weighted fair) or stride (proportional share).\n"
+			"  -slice-min=N       Shrink time slices of threads that block early\n"
+			"                     down to N ticks (default 4).\n"
+			"  -slice-max=N       Grow time slices of CPU-bound threads up to\n"
+			"                     N ticks (default 4).\n"
+			"  -tickless          Stop the periodic timer tick while idle.\n"
+			"  -zero-threads      Zero recycled thread pages while idle.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -354,6 +438,15 @@ static void
 print_stats (void) {
 	timer_print_stats ();
 	thread_print_stats ();
+	thread_print_latency ();
+	fpu_print_stats ();
+	palloc_print_stats ();
+	kmem_print_stats ();
+	if (print_top)
+		thread_print_top ();
+#ifdef LOCKSTAT
+	lockstat_print ();
+#endif
 #ifdef FILESYS
 	disk_print_stats ();
 #endif
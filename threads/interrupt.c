@@ -370,6 +370,16 @@ intr_handler (struct intr_frame *frame) {
 		if (yield_on_return)
 			thread_yield ();
 	}
+
+#ifdef USERPROG
+	/* Don't return to user mode in a thread whose process was
+	   terminated by another of its threads (see group_leave() in
+	   userprog/process.c). */
+	if (frame->cs == SEL_UCSEG && thread_current ()->killed) {
+		intr_enable ();
+		thread_exit ();
+	}
+#endif
 }
 
 /* Dumps interrupt frame F to the console, for debugging. */
@@ -23,6 +23,9 @@ pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
 			} else
 				return NULL;
 		}
+		/* 2 MB 페이지면 아래에 페이지 테이블이 없다.  PDE를 그대로 준다. */
+		if (pdp[idx] & PTE_PS)
+			return &pdp[idx];
 		return (uint64_t *) ptov (PTE_ADDR (pdp[idx]) + 8 * PTX (va));
 	}
 	return NULL;
@@ -46,6 +49,9 @@ pdpe_walk (uint64_t *pdpe, const uint64_t va, int create) {
 			} else
 				return NULL;
 		}
+		/* 1 GB 페이지면 PDPE가 곧 마지막 단계다. */
+		if (pdpe[idx] & PTE_PS)
+			return &pdpe[idx];
 		pte = pgdir_walk (ptov (PTE_ADDR (pdpe[idx])), va, create);
 	}
 	if (pte == NULL && allocated) {
@@ -59,7 +65,9 @@ pdpe_walk (uint64_t *pdpe, const uint64_t va, int create) {
  * PML4 엔트리가 VADDR에 대한 페이지 테이블을 가지고 있지 않은 경우,
  * CREATE 매개변수에 따라 동작이 달라집니다.
  * CREATE가 true로 설정된 경우, 새로운 페이지 테이블이 생성되고 해당 테이블로의 포인터가 반환됩니다.
- * 그렇지 않으면 널 포인터가 반환됩니다. */
+ * 그렇지 않으면 널 포인터가 반환됩니다.
+ * VADDR이 2 MB나 1 GB 페이지 안에 있으면 그 페이지를 매핑하는 PDE나 PDPE를
+ * 반환한다.  이 엔트리에는 PTE_PS가 켜져 있다 (is_large_pte()). */
 uint64_t *
 pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
 	uint64_t *pte = NULL;
@@ -87,6 +95,41 @@ pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
 	return pte;
 }
 
+/* PML4에서 VA를 덮는 페이지 디렉터리 엔트리의 주소를 반환한다.
+ * 여기에 PTE_PS를 켜고 2 MB 정렬 물리 주소를 넣으면 2 MB 페이지가 된다.
+ * 중간 단계가 없으면 CREATE일 때만 만들고, 아니면 널 포인터를 반환한다.
+ * VA가 이미 1 GB 페이지로 매핑되어 있어도 널 포인터를 반환한다. */
+uint64_t *
+pml4_pde_walk (uint64_t *pml4, const uint64_t va, int create) {
+	uint64_t *pdpe, *pgdir;
+	int allocated = 0;
+
+	if (!(pml4[PML4 (va)] & PTE_P)) {
+		uint64_t *new_page = create ? palloc_get_page (PAL_ZERO) : NULL;
+		if (new_page == NULL)
+			return NULL;
+		pml4[PML4 (va)] = vtop (new_page) | PTE_U | PTE_W | PTE_P;
+		allocated = 1;
+	}
+	pdpe = ptov (PTE_ADDR (pml4[PML4 (va)]));
+
+	if (pdpe[PDPE (va)] & PTE_PS)
+		return NULL;
+	if (!(pdpe[PDPE (va)] & PTE_P)) {
+		uint64_t *new_page = create ? palloc_get_page (PAL_ZERO) : NULL;
+		if (new_page == NULL) {
+			if (allocated) {
+				palloc_free_page (pdpe);
+				pml4[PML4 (va)] = 0;
+			}
+			return NULL;
+		}
+		pdpe[PDPE (va)] = vtop (new_page) | PTE_U | PTE_W | PTE_P;
+	}
+	pgdir = ptov (PTE_ADDR (pdpe[PDPE (va)]));
+	return &pgdir[PDX (va)];
+}
+
 /*
  * 커널 가상 주소에 대한 매핑을 갖고 있는
  * 새로운 페이지 맵 레벨 4 (pml4)를 생성하며,
@@ -125,10 +168,18 @@ pgdir_for_each (uint64_t *pdp, pte_for_each_func *func, void *aux,
 		unsigned pml4_index, unsigned pdp_index) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
-			if (!pt_for_each ((uint64_t *) PTE_ADDR (pte), func, aux,
-					pml4_index, pdp_index, i))
+		if (!(((uint64_t) pte) & PTE_P))
+			continue;
+		/* 2 MB 페이지는 PDE 하나로 FUNC를 한 번만 부른다. */
+		if (pdp[i] & PTE_PS) {
+			void *va = (void *) (((uint64_t) pml4_index << PML4SHIFT) |
+								 ((uint64_t) pdp_index << PDPESHIFT) |
+								 ((uint64_t) i << PDXSHIFT));
+			if (!func (&pdp[i], va, aux))
 				return false;
+		} else if (!pt_for_each ((uint64_t *) PTE_ADDR (pte), func, aux,
+					pml4_index, pdp_index, i))
+			return false;
 	}
 	return true;
 }
@@ -138,15 +189,24 @@ pdp_for_each (uint64_t *pdp,
 		pte_for_each_func *func, void *aux, unsigned pml4_index) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pde = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pde) & PTE_P)
-			if (!pgdir_for_each ((uint64_t *) PTE_ADDR (pde), func,
-					 aux, pml4_index, i))
+		if (!(((uint64_t) pde) & PTE_P))
+			continue;
+		/* 1 GB 페이지도 마찬가지. */
+		if (pdp[i] & PTE_PS) {
+			void *va = (void *) (((uint64_t) pml4_index << PML4SHIFT) |
+								 ((uint64_t) i << PDPESHIFT));
+			if (!func (&pdp[i], va, aux))
 				return false;
+		} else if (!pgdir_for_each ((uint64_t *) PTE_ADDR (pde), func,
+					 aux, pml4_index, i))
+			return false;
 	}
 	return true;
 }
 
-/* Apply FUNC to each available pte entries including kernel's. */
+/* Apply FUNC to each available pte entries including kernel's.
+   2 MB/1 GB 페이지는 FUNC에 PTE 대신 PTE_PS가 켜진 PDE/PDPE가 넘어가고,
+   VA는 그 페이지의 시작 주소다. */
 bool
 pml4_for_each (uint64_t *pml4, pte_for_each_func *func, void *aux) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
@@ -172,7 +232,8 @@ static void
 pgdir_destroy (uint64_t *pdp) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
+		/* 2 MB 페이지는 palloc에서 온 것이 아니므로 풀어 줄 것이 없다. */
+		if ((((uint64_t) pte) & PTE_P) && !(pdp[i] & PTE_PS))
 			pt_destroy (PTE_ADDR (pte));
 	}
 	palloc_free_page ((void *) pdp);
@@ -182,7 +243,7 @@ static void
 pdpe_destroy (uint64_t *pdpe) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pde = ptov((uint64_t *) pdpe[i]);
-		if (((uint64_t) pde) & PTE_P)
+		if ((((uint64_t) pde) & PTE_P) && !(pdpe[i] & PTE_PS))
 			pgdir_destroy ((void *) PTE_ADDR (pde));
 	}
 	palloc_free_page ((void *) pdpe);
@@ -2,14 +2,15 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/loader.h"
-#include "threads/synch.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -24,13 +25,71 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool is a binary buddy allocator.  Free memory is kept
+   as naturally aligned blocks of 2**K pages, 0 <= K <=
+   PALLOC_MAX_ORDER, one list per order.  The list elements live
+   in a per-page array in the pool's metadata, not in the free
+   pages themselves, so the allocator never touches a page it has
+   not handed out.  A per-order bitmap records which block heads
+   are free so that a freed block can find and merge with its
+   buddy in constant time.  A request
+   for N pages takes a block of order ceil(log2(N)) and gives
+   the unused tail back, so callers may still ask for any page
+   count up to 2**PALLOC_MAX_ORDER.
+
+   palloc_free_multiple() is called from the scheduler with
+   interrupts off (thread and FPU pages), so the pools are
+   protected by disabling interrupts rather than by a lock.
+   Every critical section is O(PALLOC_MAX_ORDER).  Since there is
+   no pool lock, LOCKSTAT builds do not report palloc; its cost
+   shows up as interrupt latency instead.
+
+   Each pool also keeps a small reserve of pages that the idle
+   thread has already zeroed (see palloc_zero_idle()), so that
+   single-page PAL_ZERO requests such as page tables, fd tables
+   and zero-fill user pages skip the memset.  Reserve pages count
+   as allocated; they are handed back to the buddy lists if the
+   pool otherwise runs dry.
+
+   Until paging_init() has built the full direct map, only the
+   first BOOT_MAP_SIZE bytes of physical memory are mapped (see
+   start.S).  Until palloc_paging_ready() is called, allocations
+   are therefore served only from blocks below that limit. */
+
+/* Largest block order: 2**10 pages = 4 MB. */
+#define PALLOC_MAX_ORDER 10
+#define ORDER_CNT (PALLOC_MAX_ORDER + 1)
+
+/* Number of pre-zeroed pages to keep in each pool. */
+#define ZERO_RESERVE 64
+
+/* Physical memory mapped by the boot page tables in start.S. */
+#define BOOT_MAP_SIZE (256 * 1024 * 1024)
+
+/* Kernel virtual address of the end of the boot mapping, or 0
+   once paging_init() has mapped all of memory. */
+static uint64_t boot_map_end;
 
 /* A memory pool. */
 struct pool {
-	struct lock lock;               /* Mutual exclusion. */
-	struct bitmap *used_map;        /* Bitmap of free pages. */
+	const char *name;               /* "kernel" or "user". */
+	struct bitmap *used_map;        /* Bitmap of allocated pages. */
 	uint8_t *base;                  /* Base of pool. */
+	size_t page_cnt;                /* Number of pages in pool. */
+
+	struct list_elem *links;        /* Free/zeroed list element of each page. */
+	struct list free[ORDER_CNT];    /* Free blocks of each order. */
+	struct bitmap *free_map[ORDER_CNT]; /* Bit I: block I free. */
+	size_t free_cnt[ORDER_CNT];     /* Length of each free list. */
+	unsigned free_orders;           /* Bit K: free[K] nonempty. */
+	size_t free_pages;              /* Total free pages. */
+
+	struct list zeroed;             /* Pre-zeroed reserve pages (links). */
+	size_t zeroed_cnt;              /* Length of zeroed. */
+	long long zero_hits;            /* PAL_ZERO served from zeroed. */
+	long long zero_misses;          /* PAL_ZERO that had to memset. */
 };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -38,10 +97,12 @@ static struct pool kernel_pool, user_pool;
 
 /* Maximum number of pages to put in user pool. */
 size_t user_page_limit = SIZE_MAX;
-static void
-init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
+static void init_pool (struct pool *p, const char *name, void **bm_base,
+		uint64_t start, uint64_t end);
 
 static bool page_from_pool (const struct pool *, void *page);
+static void free_range (struct pool *, size_t page_idx, size_t page_cnt);
+static void print_pool_stats (const struct pool *);
 
 /* multiboot info */
 struct multiboot_info {
@@ -158,7 +219,7 @@ populate_pools (struct area *base_mem, struct area *ext_mem) {
 						break;
 					}
 					// generate kernel pool
-					init_pool (&kernel_pool,
+					init_pool (&kernel_pool, "kernel",
 							&free_start, region_start, start + rem * PGSIZE);
 					// Transition to the next state
 					if (rem == size_in_pg) {
@@ -188,7 +249,7 @@ populate_pools (struct area *base_mem, struct area *ext_mem) {
 	}
 
 	// generate the user pool
-	init_pool(&user_pool, &free_start, region_start, end);
+	init_pool (&user_pool, "user", &free_start, region_start, end);
 
 	// Iterate over the e820_entry. Setup the usable.
 	uint64_t usable_bound = (uint64_t) free_start;
@@ -219,16 +280,18 @@ split:
 			else
 				NOT_REACHED ();
 
-			pool_end = pool->base + bitmap_size (pool->used_map) * PGSIZE;
+			pool_end = pool->base + pool->page_cnt * PGSIZE;
 			page_idx = pg_no (start) - pg_no (pool->base);
 			if ((uint64_t) pool_end < end) {
 				page_cnt = ((uint64_t) pool_end - start) / PGSIZE;
 				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				free_range (pool, page_idx, page_cnt);
 				start = (uint64_t) pool_end;
 				goto split;
 			} else {
 				page_cnt = ((uint64_t) end - start) / PGSIZE;
 				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				free_range (pool, page_idx, page_cnt);
 			}
 		}
 	}
@@ -249,10 +312,169 @@ palloc_init (void) {
 		  base_mem.start, base_mem.end, base_mem.size / 1024);
 	printf ("\text_mem: 0x%llx ~ 0x%llx (Usable: %'llu kB)\n",
 		  ext_mem.start, ext_mem.end, ext_mem.size / 1024);
+	boot_map_end = (uint64_t) ptov (BOOT_MAP_SIZE);
 	populate_pools (&base_mem, &ext_mem);
+	palloc_print_stats ();
 	return ext_mem.end;
 }
 
+/* Returns the smallest order K with 2**K >= PAGE_CNT. */
+static unsigned
+order_of (size_t page_cnt) {
+	ASSERT (page_cnt > 0);
+	return page_cnt == 1 ? 0 : 64 - __builtin_clzll (page_cnt - 1);
+}
+
+/* Returns the kernel address of the page at PAGE_IDX in POOL. */
+static inline void *
+pool_page (const struct pool *pool, size_t page_idx) {
+	return pool->base + PGSIZE * page_idx;
+}
+
+/* Called once paging_init() has mapped all of physical memory:
+   lifts the restriction to the boot mapping. */
+void
+palloc_paging_ready (void) {
+	boot_map_end = 0;
+}
+
+/* Returns the index of the page whose list element is E. */
+static inline size_t
+link_idx (const struct pool *pool, const struct list_elem *e) {
+	return e - pool->links;
+}
+
+/* Adds the free block of ORDER at PAGE_IDX to POOL's free lists. */
+static void
+push_block (struct pool *pool, size_t page_idx, unsigned order) {
+	list_push_front (&pool->free[order], &pool->links[page_idx]);
+	bitmap_mark (pool->free_map[order], page_idx >> order);
+	pool->free_cnt[order]++;
+	pool->free_orders |= 1u << order;
+}
+
+/* Removes the free block of ORDER at PAGE_IDX from POOL's free
+   lists. */
+static void
+remove_block (struct pool *pool, size_t page_idx, unsigned order) {
+	list_remove (&pool->links[page_idx]);
+	bitmap_reset (pool->free_map[order], page_idx >> order);
+	if (--pool->free_cnt[order] == 0)
+		pool->free_orders &= ~(1u << order);
+}
+
+/* Frees the block of ORDER at PAGE_IDX, merging it with its buddy
+   for as long as the buddy is free too. */
+static void
+free_block (struct pool *pool, size_t page_idx, unsigned order) {
+	while (order < PALLOC_MAX_ORDER) {
+		size_t buddy = page_idx ^ ((size_t) 1 << order);
+		struct bitmap *map = pool->free_map[order];
+
+		if ((buddy >> order) >= bitmap_size (map)
+				|| !bitmap_test (map, buddy >> order))
+			break;
+		remove_block (pool, buddy, order);
+		page_idx &= ~((size_t) 1 << order);
+		order++;
+	}
+	push_block (pool, page_idx, order);
+}
+
+/* Frees PAGE_CNT pages starting at PAGE_IDX by splitting the range
+   into the largest aligned blocks that fit. */
+static void
+free_range (struct pool *pool, size_t page_idx, size_t page_cnt) {
+	pool->free_pages += page_cnt;
+	while (page_cnt > 0) {
+		unsigned order = page_idx != 0 ? __builtin_ctzll (page_idx) : 63;
+		if (order > PALLOC_MAX_ORDER)
+			order = PALLOC_MAX_ORDER;
+		while (((size_t) 1 << order) > page_cnt)
+			order--;
+
+		free_block (pool, page_idx, order);
+		page_idx += (size_t) 1 << order;
+		page_cnt -= (size_t) 1 << order;
+	}
+}
+
+/* Finds the smallest free block of order WANT or above in POOL
+   that lies below boot_map_end.  Stores its order in *ORDER and
+   returns its index, or BITMAP_ERROR if there is none.  Only used
+   during boot, while the free lists are short. */
+static size_t
+find_boot_block (struct pool *pool, unsigned want, unsigned *order) {
+	for (unsigned k = want; k < ORDER_CNT; k++) {
+		struct list_elem *e;
+
+		for (e = list_begin (&pool->free[k]); e != list_end (&pool->free[k]);
+				e = list_next (e)) {
+			size_t page_idx = link_idx (pool, e);
+			uint64_t end = (uint64_t) pool_page (pool, page_idx + ((size_t) 1 << k));
+
+			if (end <= boot_map_end) {
+				*order = k;
+				return page_idx;
+			}
+		}
+	}
+	return BITMAP_ERROR;
+}
+
+/* Allocates PAGE_CNT contiguous pages from POOL and returns the
+   index of the first, or BITMAP_ERROR if no block is large enough. */
+static size_t
+alloc_range (struct pool *pool, size_t page_cnt) {
+	unsigned want = order_of (page_cnt);
+	unsigned order, avail;
+	size_t page_idx;
+
+	if (want > PALLOC_MAX_ORDER)
+		return BITMAP_ERROR;
+
+	/* Take the smallest free block that is large enough and split
+	   it down, handing the upper halves back to the free lists. */
+	if (boot_map_end != 0) {
+		page_idx = find_boot_block (pool, want, &order);
+		if (page_idx == BITMAP_ERROR)
+			return BITMAP_ERROR;
+	} else {
+		avail = pool->free_orders & ~((1u << want) - 1);
+		if (avail == 0)
+			return BITMAP_ERROR;
+		order = __builtin_ctz (avail);
+		page_idx = link_idx (pool, list_front (&pool->free[order]));
+	}
+	remove_block (pool, page_idx, order);
+	while (order > want) {
+		order--;
+		push_block (pool, page_idx + ((size_t) 1 << order), order);
+	}
+	pool->free_pages -= (size_t) 1 << want;
+
+	/* Give back the pages past PAGE_CNT. */
+	if (page_cnt < ((size_t) 1 << want))
+		free_range (pool, page_idx + page_cnt,
+				((size_t) 1 << want) - page_cnt);
+
+	ASSERT (!bitmap_any (pool->used_map, page_idx, page_cnt));
+	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+	return page_idx;
+}
+
+/* Returns every page in POOL's zeroed reserve to the free lists. */
+static void
+drain_zeroed (struct pool *pool) {
+	while (!list_empty (&pool->zeroed)) {
+		size_t page_idx = link_idx (pool, list_pop_front (&pool->zeroed));
+
+		bitmap_reset (pool->used_map, page_idx);
+		free_range (pool, page_idx, 1);
+	}
+	pool->zeroed_cnt = 0;
+}
+
 /* Obtains and returns a group of PAGE_CNT contiguous free pages.
    If PAL_USER is set, the pages are obtained from the user pool,
    otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
@@ -263,18 +485,33 @@ void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
 
-	lock_acquire (&pool->lock);
-	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-	lock_release (&pool->lock);
-	void *pages;
+	void *pages = NULL;
+	bool zeroed = false;
 
-	if (page_idx != BITMAP_ERROR)
-		pages = pool->base + PGSIZE * page_idx;
-	else
-		pages = NULL;
+	if (page_cnt == 0)
+		return NULL;
 
-	if (pages) {
+	enum intr_level old_level = intr_disable ();
+	if ((flags & PAL_ZERO) && page_cnt == 1 && !list_empty (&pool->zeroed)) {
+		pages = pool_page (pool, link_idx (pool, list_pop_front (&pool->zeroed)));
+		pool->zeroed_cnt--;
+		pool->zero_hits++;
+		zeroed = true;
+	} else {
+		size_t page_idx = alloc_range (pool, page_cnt);
+		if (page_idx == BITMAP_ERROR && pool->zeroed_cnt > 0) {
+			drain_zeroed (pool);
+			page_idx = alloc_range (pool, page_cnt);
+		}
+		if (page_idx != BITMAP_ERROR)
+			pages = pool->base + PGSIZE * page_idx;
 		if (flags & PAL_ZERO)
+			pool->zero_misses++;
+	}
+	intr_set_level (old_level);
+
+	if (pages) {
+		if (!zeroed && (flags & PAL_ZERO))
 			memset (pages, 0, PGSIZE * page_cnt);
 	} else {
 		if (flags & PAL_ASSERT)
@@ -296,11 +533,53 @@ palloc_get_page (enum palloc_flags flags) {
 	return palloc_get_multiple (flags, 1);
 }
 
+/* Called by the idle thread with interrupts off.  Takes one free
+   page from a pool whose zeroed reserve is short, zeroes it and
+   adds it to the reserve.  Returns true if it did so, false if
+   every reserve is full or the pools are too low on memory to
+   spare a page.
+
+   Interrupts are off only while the page is taken from the free
+   lists and while it is pushed onto the reserve; the memset runs
+   with interrupts on, so a thread woken meanwhile preempts the
+   idle thread at once.  The page is marked used in the meantime,
+   so nothing else can hand it out.  Returns with interrupts off
+   again. */
+bool
+palloc_zero_idle (void) {
+	struct pool *pools[] = { &kernel_pool, &user_pool };
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	for (size_t i = 0; i < sizeof pools / sizeof *pools; i++) {
+		struct pool *pool = pools[i];
+		size_t page_idx;
+		void *page;
+
+		if (pool->zeroed_cnt >= ZERO_RESERVE
+				|| pool->free_pages <= ZERO_RESERVE * 2)
+			continue;
+		page_idx = alloc_range (pool, 1);
+		if (page_idx == BITMAP_ERROR)
+			continue;
+
+		page = pool_page (pool, page_idx);
+		intr_enable ();
+		memset (page, 0, PGSIZE);
+		intr_disable ();
+		list_push_back (&pool->zeroed, &pool->links[page_idx]);
+		pool->zeroed_cnt++;
+		return true;
+	}
+	return false;
+}
+
 /* Frees the PAGE_CNT pages starting at PAGES. */
 void
 palloc_free_multiple (void *pages, size_t page_cnt) {
 	struct pool *pool;
 	size_t page_idx;
+	enum intr_level old_level;
 
 	ASSERT (pg_ofs (pages) == 0);
 	if (pages == NULL || page_cnt == 0)
@@ -318,8 +597,11 @@ palloc_free_multiple (void *pages, size_t page_cnt) {
 #ifndef NDEBUG
 	memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
+	old_level = intr_disable ();
 	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
 	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	free_range (pool, page_idx, page_cnt);
+	intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -330,21 +612,49 @@ palloc_free_page (void *page) {
 
 /* Initializes pool P as starting at START and ending at END */
 static void
-init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
+init_pool (struct pool *p, const char *name, void **bm_base,
+		uint64_t start, uint64_t end) {
+  /* We'll put the pool's list elements, used_map and the buddy
+     free maps at BM_BASE.  Calculate the space needed for them
+     and advance BM_BASE past them. */
 	uint64_t pgcnt = (end - start) / PGSIZE;
-	size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (pgcnt), PGSIZE) * PGSIZE;
-
-	lock_init(&p->lock);
-	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_pages);
+	size_t bm_bytes = pgcnt * sizeof (struct list_elem)
+		+ bitmap_buf_size (pgcnt);
+	uint8_t *buf = *bm_base;
+	unsigned order;
+
+	for (order = 0; order < ORDER_CNT; order++)
+		bm_bytes += ROUND_UP (bitmap_buf_size (pgcnt >> order), sizeof (long));
+	bm_bytes = DIV_ROUND_UP (bm_bytes, PGSIZE) * PGSIZE;
+
+	p->name = name;
+	p->links = (struct list_elem *) buf;
+	buf += pgcnt * sizeof (struct list_elem);
+	p->used_map = bitmap_create_in_buf (pgcnt, buf, bitmap_buf_size (pgcnt));
+	buf += bitmap_buf_size (pgcnt);
 	p->base = (void *) start;
+	p->page_cnt = pgcnt;
 
 	// Mark all to unusable.
 	bitmap_set_all(p->used_map, true);
 
-	*bm_base += bm_pages;
+	// No free blocks until populate_pools() hands them over.
+	for (order = 0; order < ORDER_CNT; order++) {
+		size_t size = ROUND_UP (bitmap_buf_size (pgcnt >> order), sizeof (long));
+		list_init (&p->free[order]);
+		p->free_map[order] = bitmap_create_in_buf (pgcnt >> order, buf, size);
+		bitmap_set_all (p->free_map[order], false);
+		p->free_cnt[order] = 0;
+		buf += size;
+	}
+	p->free_orders = 0;
+	p->free_pages = 0;
+
+	list_init (&p->zeroed);
+	p->zeroed_cnt = 0;
+	p->zero_hits = p->zero_misses = 0;
+
+	*bm_base += bm_bytes;
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -353,6 +663,42 @@ static bool
 page_from_pool (const struct pool *pool, void *page) {
 	size_t page_no = pg_no (page);
 	size_t start_page = pg_no (pool->base);
-	size_t end_page = start_page + bitmap_size (pool->used_map);
+	size_t end_page = start_page + pool->page_cnt;
 	return page_no >= start_page && page_no < end_page;
 }
+
+/* Prints free space and fragmentation of POOL: the free page
+   count, the largest free block, and the number of free blocks
+   of each order. */
+static void
+print_pool_stats (const struct pool *pool) {
+	enum intr_level old_level = intr_disable ();
+	size_t free_cnt[ORDER_CNT];
+	size_t free_pages = pool->free_pages;
+	unsigned free_orders = pool->free_orders;
+	size_t zeroed_cnt = pool->zeroed_cnt;
+	long long zero_hits = pool->zero_hits;
+	long long zero_misses = pool->zero_misses;
+	unsigned order;
+
+	memcpy (free_cnt, pool->free_cnt, sizeof free_cnt);
+	intr_set_level (old_level);
+
+	printf ("palloc: %s pool: %zu of %zu pages free", pool->name,
+			free_pages, pool->page_cnt);
+	if (free_orders != 0)
+		printf (", largest block %zu pages",
+				(size_t) 1 << (31 - __builtin_clz (free_orders)));
+	printf ("\n  free blocks by order:");
+	for (order = 0; order < ORDER_CNT; order++)
+		printf (" %zu", free_cnt[order]);
+	printf ("\n  zeroed reserve: %zu pages, %lld hits, %lld misses\n",
+			zeroed_cnt, zero_hits, zero_misses);
+}
+
+/* Prints page allocator statistics. */
+void
+palloc_print_stats (void) {
+	print_pool_stats (&kernel_pool);
+	print_pool_stats (&user_pool);
+}
@@ -0,0 +1,159 @@
+#include "threads/rcu.h"
+#include <debug.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+
+/* Read-copy update.  rcu.h의 설명 참고.
+
+   epoch가 G일 때 새 reader는 readers[G % 2]에, 새 callback은
+   waiting[G % 2]에 들어간다.  readers[(G - 1) % 2]가 0이 되면 G - 1
+   이전에 들어온 reader가 모두 나간 것이므로 G - 1에 들어온 callback을
+   done으로 옮기고 G + 1로 넘어간다.  G + 1은 비워진 칸을 다시 쓴다.
+   모든 카운터와 리스트는 인터럽트를 꺼서 보호한다. */
+
+static unsigned epoch;              /* 현재 epoch */
+static int readers[2];              /* epoch별 read-side 안의 스레드 수 */
+static struct list waiting[2];      /* epoch별 grace period를 기다리는 callback */
+static struct list done;            /* 실행해도 되는 callback */
+
+static struct workqueue *rcu_wq;
+static struct work rcu_work;        /* done을 비우는 work */
+
+static work_func rcu_reclaim;
+
+/* Initializes RCU.  thread_start() 뒤, 처음 call_rcu() 전에 부른다. */
+void
+rcu_init (void) {
+	list_init (&waiting[0]);
+	list_init (&waiting[1]);
+	list_init (&done);
+	work_init (&rcu_work);
+	rcu_wq = wq_create ("rcu", PRI_DEFAULT, 1);
+	if (rcu_wq == NULL)
+		PANIC ("rcu: cannot create workqueue");
+}
+
+/* read-side에 들어간다.  중첩할 수 있다. */
+void
+rcu_read_lock (void) {
+	struct thread *t = thread_current ();
+	enum intr_level old_level = intr_disable ();
+
+	if (t->rcu_nesting++ == 0) {
+		t->rcu_epoch = epoch;
+		readers[epoch % 2]++;
+	}
+	intr_set_level (old_level);
+}
+
+/* read-side에서 나온다. */
+void
+rcu_read_unlock (void) {
+	struct thread *t = thread_current ();
+	enum intr_level old_level = intr_disable ();
+
+	ASSERT (t->rcu_nesting > 0);
+	if (--t->rcu_nesting == 0)
+		readers[t->rcu_epoch % 2]--;
+	intr_set_level (old_level);
+}
+
+/* 지금 read-side 안에 있는 reader가 모두 나간 뒤에 FUNC (HEAD)를
+   "rcu" workqueue에서 부른다.  인터럽트 핸들러에서도 부를 수 있다. */
+void
+call_rcu (struct rcu_head *head, void (*func) (struct rcu_head *)) {
+	enum intr_level old_level;
+
+	ASSERT (head != NULL);
+	ASSERT (func != NULL);
+	ASSERT (rcu_wq != NULL);
+
+	head->func = func;
+	old_level = intr_disable ();
+	list_push_back (&waiting[epoch % 2], &head->elem);
+	intr_set_level (old_level);
+
+	/* epoch는 문맥 교환 때만 넘어가므로 매 tick 확인한다. */
+	wq_queue_delayed (rcu_wq, &rcu_work, rcu_reclaim, NULL, 1);
+}
+
+struct rcu_sync {
+	struct rcu_head head;
+	struct semaphore done;
+};
+
+static void
+rcu_sync_done (struct rcu_head *head) {
+	sema_up (&rcu_entry (head, struct rcu_sync, head)->done);
+}
+
+/* 지금 read-side 안에 있는 reader가 모두 나갈 때까지 기다린다.
+   read-side 안에서 부르면 안 된다. */
+void
+rcu_synchronize (void) {
+	struct rcu_sync sync;
+
+	ASSERT (!intr_context ());
+	ASSERT (thread_current ()->rcu_nesting == 0);
+
+	sema_init (&sync.done, 0);
+	call_rcu (&sync.head, rcu_sync_done);
+	sema_down (&sync.done);
+}
+
+/* schedule()에서 문맥 교환 때마다 불린다: O(1).
+   이전 epoch의 reader가 모두 나갔으면 epoch를 넘긴다. */
+void
+rcu_quiescent (void) {
+	struct list *ready;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (readers[(epoch - 1) % 2] != 0
+			|| (list_empty (&waiting[0]) && list_empty (&waiting[1])))
+		return;
+
+	ready = &waiting[(epoch - 1) % 2];
+	list_splice (list_end (&done), list_begin (ready), list_end (ready));
+	epoch++;
+}
+
+/* ELEM을 BEFORE 앞에 넣는다.  list_insert()와 같지만 ELEM을 다 채운
+   뒤에 앞 원소의 next에 걸어서, 앞으로 훑는 reader가 반쯤 들어간
+   ELEM을 보지 않게 한다.  writer끼리는 호출자가 막는다. */
+void
+rcu_list_insert (struct list_elem *before, struct list_elem *elem) {
+	ASSERT (before != NULL);
+	ASSERT (elem != NULL);
+
+	elem->prev = before->prev;
+	elem->next = before;
+	barrier ();
+	before->prev->next = elem;
+	before->prev = elem;
+}
+
+/* "rcu" workqueue: grace period가 지난 callback을 실행한다.
+   아직 기다리는 callback이 있으면 다음 tick에 다시 본다. */
+static void
+rcu_reclaim (void *aux UNUSED) {
+	struct list ready;
+	enum intr_level old_level;
+	bool pending;
+
+	list_init (&ready);
+	old_level = intr_disable ();
+	list_splice (list_end (&ready), list_begin (&done), list_end (&done));
+	pending = !list_empty (&waiting[0]) || !list_empty (&waiting[1]);
+	intr_set_level (old_level);
+
+	while (!list_empty (&ready)) {
+		struct rcu_head *head = list_entry (list_pop_front (&ready),
+				struct rcu_head, elem);
+		head->func (head);
+	}
+
+	if (pending)
+		wq_queue_delayed (rcu_wq, &rcu_work, rcu_reclaim, NULL, 1);
+}
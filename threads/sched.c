@@ -0,0 +1,260 @@
+#include "threads/sched.h"
+#include <debug.h>
+#include <string.h>
+#include "threads/interrupt.h"
+
+/* Scheduler classes.  sched.h의 설명 참고. */
+
+/* 우선순위 PRI_DEFAULT가 Linux의 nice 0 (weight 1024)에 해당하고
+   우선순위가 1 오를 때마다 weight가 약 1.25배가 된다.
+   [PRI_DEFAULT - 19, PRI_DEFAULT + 20] 밖은 양 끝 값으로 자른다. */
+static const int prio_to_weight[40] = {
+	/* PRI_DEFAULT + 20 */ 88761, 71755, 56483, 46273, 36291,
+	/* PRI_DEFAULT + 15 */ 29154, 23254, 18705, 14949, 11916,
+	/* PRI_DEFAULT + 10 */  9548,  7620,  6100,  4904,  3906,
+	/* PRI_DEFAULT +  5 */  3121,  2501,  1991,  1586,  1277,
+	/* PRI_DEFAULT      */  1024,   820,   655,   526,   423,
+	/* PRI_DEFAULT -  5 */   335,   272,   215,   172,   137,
+	/* PRI_DEFAULT - 10 */   110,    87,    70,    56,    45,
+	/* PRI_DEFAULT - 15 */    36,    29,    23,    18,    15,
+};
+#define WEIGHT_0 1024               /* PRI_DEFAULT의 weight */
+
+/* 1 tick 동안 실행한 weight 1024 스레드의 vruntime 증가량 */
+#define CFS_TICK_DELTA 1024
+/* 앞선 스레드를 선점하기 전에 허용하는 vruntime 차이 (weight 1024 기준 2 tick) */
+#define CFS_GRANULARITY (2 * CFS_TICK_DELTA)
+/* 잠들었다 깨어난 스레드에게 min_key보다 앞서도록 주는 여유 */
+#define CFS_SLEEP_CREDIT (TIME_SLICE * CFS_TICK_DELTA / 2)
+
+/* stride = STRIDE1 / ticket */
+#define STRIDE1 (1 << 20)
+
+/* PRIORITY인 스레드의 weight (cfs), ticket 수 (stride) */
+int
+sched_weight (int priority) {
+	int idx = PRI_DEFAULT + 20 - priority;
+
+	if (idx < 0)
+		idx = 0;
+	if (idx > 39)
+		idx = 39;
+	return prio_to_weight[idx];
+}
+
+/* Adaptive time slice.  sched.h의 설명 참고. */
+unsigned sched_slice_min = TIME_SLICE;
+unsigned sched_slice_max = TIME_SLICE;
+
+/* 새 스레드의 slice: TIME_SLICE를 [min, max]로 자른 값 */
+unsigned
+sched_slice_init (void) {
+	if (TIME_SLICE < sched_slice_min)
+		return sched_slice_min;
+	if (TIME_SLICE > sched_slice_max)
+		return sched_slice_max;
+	return TIME_SLICE;
+}
+
+/* T가 이번 slice에서 USED tick을 쓰고 CPU를 놓았다.  BLOCKED면 스스로
+   block한 것.  schedule()에서 인터럽트가 꺼진 채로 불린다. */
+void
+sched_slice_adapt (struct thread *t, unsigned used, bool blocked) {
+	if (blocked && used < t->slice) {
+		if (t->slice > sched_slice_min)
+			t->slice--;
+	} else if (!blocked && used >= t->slice)
+		t->slice = t->slice * 2 < sched_slice_max ? t->slice * 2 : sched_slice_max;
+}
+
+/* 깨어난 T가 짧은 slice를 받는 I/O 위주 스레드인지 */
+static bool
+slice_interactive (const struct thread *t) {
+	return t->wake_stamp != 0 && t->slice < sched_slice_init ();
+}
+
+/* Priority class. */
+
+static void
+prio_init (struct runqueue *rq) {
+	for (int pri = PRI_MIN; pri <= PRI_MAX; pri++)
+		list_init (&rq->queue[pri]);
+	rq->bitmap = 0;
+}
+
+/* T를 자신의 우선순위 레벨 FIFO 맨 뒤에 넣는다: O(1).
+   깨어난 I/O 위주 스레드는 맨 앞에 넣는다. */
+static void
+prio_enqueue (struct runqueue *rq, struct thread *t) {
+	ASSERT (PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+	if (slice_interactive (t))
+		list_push_front (&rq->queue[t->priority], &t->elem);
+	else
+		list_push_back (&rq->queue[t->priority], &t->elem);
+	rq->bitmap |= 1ULL << t->priority;
+}
+
+/* T가 들어있는 레벨은 항상 T->priority와 같아야 한다. */
+static void
+prio_dequeue (struct runqueue *rq, struct thread *t) {
+	list_remove (&t->elem);
+	if (list_empty (&rq->queue[t->priority]))
+		rq->bitmap &= ~(1ULL << t->priority);
+}
+
+/* 비어있지 않은 가장 높은 레벨 = 가장 높은 set bit (bsr 한 번) */
+static struct thread *
+prio_pick_next (struct runqueue *rq) {
+	struct thread *t;
+	int pri;
+
+	if (rq->bitmap == 0)
+		return NULL;
+	pri = 63 - __builtin_clzll (rq->bitmap);
+	t = list_entry (list_pop_front (&rq->queue[pri]), struct thread, elem);
+	if (list_empty (&rq->queue[pri]))
+		rq->bitmap &= ~(1ULL << pri);
+	return t;
+}
+
+/* slice를 다 쓰면 같은 레벨의 다음 스레드에게 양보 */
+static bool
+prio_tick (struct runqueue *rq UNUSED, struct thread *curr, unsigned ticks) {
+	return ticks >= curr->slice;
+}
+
+const struct sched_class sched_priority = {
+	.name = "priority",
+	.init = prio_init,
+	.enqueue = prio_enqueue,
+	.dequeue = prio_dequeue,
+	.pick_next = prio_pick_next,
+	.tick = prio_tick,
+};
+
+/* cfs와 stride가 함께 쓰는 sched_key 순서의 tree.
+   key가 같으면 먼저 들어온 스레드가 앞에 온다. */
+
+static bool
+key_less (const struct rb_elem *a_, const struct rb_elem *b_,
+		void *aux UNUSED) {
+	const struct thread *a = rb_entry (a_, struct thread, sched_elem);
+	const struct thread *b = rb_entry (b_, struct thread, sched_elem);
+	return a->sched_key < b->sched_key;
+}
+
+static void
+tree_init (struct runqueue *rq) {
+	rb_init (&rq->tree, key_less, NULL);
+	rq->min_key = 0;
+}
+
+static void
+tree_dequeue (struct runqueue *rq, struct thread *t) {
+	rb_remove (&rq->tree, &t->sched_elem);
+}
+
+/* key가 가장 작은 스레드를 꺼낸다.  min_key는 뒤로 가지 않는다. */
+static struct thread *
+tree_pick_next (struct runqueue *rq) {
+	struct rb_elem *e = rb_first (&rq->tree);
+	struct thread *t;
+
+	if (e == NULL)
+		return NULL;
+	rb_remove (&rq->tree, e);
+	t = rb_entry (e, struct thread, sched_elem);
+	if (t->sched_key > rq->min_key)
+		rq->min_key = t->sched_key;
+	return t;
+}
+
+/* 실행을 기다리는 스레드 중 가장 작은 key, 없으면 UINT64_MAX */
+static uint64_t
+tree_first_key (struct runqueue *rq) {
+	struct rb_elem *e = rb_first (&rq->tree);
+	return e != NULL ? rb_entry (e, struct thread, sched_elem)->sched_key
+		: UINT64_MAX;
+}
+
+/* CFS class.  sched_key = vruntime. */
+
+/* 오래 잠들었던 스레드가 그동안 못 쓴 시간을 한꺼번에 몰아 쓰지 않도록
+   min_key - CFS_SLEEP_CREDIT 보다 뒤에서 시작하게 한다. */
+static void
+cfs_enqueue (struct runqueue *rq, struct thread *t) {
+	uint64_t floor = rq->min_key > CFS_SLEEP_CREDIT
+		? rq->min_key - CFS_SLEEP_CREDIT : 0;
+
+	if (t->sched_key < floor)
+		t->sched_key = floor;
+	rb_insert (&rq->tree, &t->sched_elem);
+}
+
+/* weight에 반비례해서 vruntime을 늘리고, 가장 뒤처진 스레드보다
+   CFS_GRANULARITY 이상 앞서면 선점한다. */
+static bool
+cfs_tick (struct runqueue *rq, struct thread *curr, unsigned ticks UNUSED) {
+	uint64_t first = tree_first_key (rq);
+
+	curr->sched_key += (uint64_t) CFS_TICK_DELTA * WEIGHT_0
+		/ sched_weight (curr->priority);
+	return first != UINT64_MAX && curr->sched_key > first + CFS_GRANULARITY;
+}
+
+static const struct sched_class sched_cfs = {
+	.name = "cfs",
+	.init = tree_init,
+	.enqueue = cfs_enqueue,
+	.dequeue = tree_dequeue,
+	.pick_next = tree_pick_next,
+	.tick = cfs_tick,
+};
+
+/* Stride class.  sched_key = pass. */
+
+/* 새로 들어오거나 잠들었다 깨어난 스레드는 global pass (min_key)에서
+   시작한다.  그보다 앞선 pass는 그대로 둔다. */
+static void
+stride_enqueue (struct runqueue *rq, struct thread *t) {
+	if (t->sched_key < rq->min_key)
+		t->sched_key = rq->min_key;
+	rb_insert (&rq->tree, &t->sched_elem);
+}
+
+/* 매 tick pass += stride.  slice를 다 썼고 pass가 더 작은
+   스레드가 기다리고 있으면 양보한다. */
+static bool
+stride_tick (struct runqueue *rq, struct thread *curr, unsigned ticks) {
+	curr->sched_key += STRIDE1 / sched_weight (curr->priority);
+	return ticks >= curr->slice && tree_first_key (rq) < curr->sched_key;
+}
+
+static const struct sched_class sched_stride = {
+	.name = "stride",
+	.init = tree_init,
+	.enqueue = stride_enqueue,
+	.dequeue = tree_dequeue,
+	.pick_next = tree_pick_next,
+	.tick = stride_tick,
+};
+
+/* 현재 scheduler class */
+const struct sched_class *sched_class = &sched_priority;
+
+static const struct sched_class *sched_classes[] = {
+	&sched_priority, &sched_cfs, &sched_stride,
+};
+
+/* 이름이 NAME인 scheduler class를 고른다.  없는 이름이면 false.
+   thread_init() 전에 불려야 한다. */
+bool
+sched_select (const char *name) {
+	for (size_t i = 0; i < sizeof sched_classes / sizeof *sched_classes; i++)
+		if (!strcmp (sched_classes[i]->name, name)) {
+			sched_class = sched_classes[i];
+			return true;
+		}
+	return false;
+}
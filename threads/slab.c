@@ -0,0 +1,290 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Slab allocator.  slab.h의 설명 참고.
+
+   slab은 페이지 하나로, 맨 앞에 struct slab, 그 뒤에 객체마다 한 칸씩인
+   다음-빈-객체 번호 배열, 그 뒤에 객체들이 온다.  빈 객체 목록을 객체
+   바깥의 배열에 두므로 빈 객체의 내용은 건드리지 않고, 그래서 CTOR로
+   만든 상태가 해제 후에도 남는다.
+
+   cache는 slab을 partial (일부 사용), full (모두 사용), empty (모두 빔)
+   세 목록에 나눠 둔다.  할당은 partial, empty, 새 페이지 순으로 찾는다.
+   empty는 한 장까지만 남기고 나머지는 공유 페이지 목록에 넘겨 다른
+   cache가 쓰게 한다.  공유 목록도 차 있으면 palloc에 돌려준다. */
+
+#define SLAB_MAGIC 0x51ab51ab
+#define FREE_END UINT16_MAX         /* 빈 객체 목록의 끝. */
+#define CACHE_EMPTY_MAX 1           /* cache마다 남겨 둘 빈 slab 수. */
+#define SHARED_PAGES_MAX 16         /* 공유 페이지 목록의 최대 길이. */
+
+/* Object cache. */
+struct kmem_cache {
+	char name[16];                  /* 통계용 이름. */
+	size_t obj_size;                /* 객체 크기, 8의 배수. */
+	size_t obj_cnt;                 /* slab 하나에 든 객체 수. */
+	size_t obj_ofs;                 /* 페이지 안에서 첫 객체의 위치. */
+	kmem_ctor_func *ctor;           /* 생성자, 없으면 null. */
+	struct lock lock;               /* 아래 목록과 통계 보호. */
+
+	struct list partial;            /* 빈 객체와 쓰는 객체가 섞인 slab. */
+	struct list full;               /* 빈 객체가 없는 slab. */
+	struct list empty;              /* 쓰는 객체가 없는 slab. */
+	size_t empty_cnt;               /* empty의 길이. */
+
+	size_t slab_cnt;                /* 가진 slab 수. */
+	size_t in_use;                  /* 나가 있는 객체 수. */
+	long long allocs;               /* kmem_cache_alloc() 횟수. */
+	long long frees;                /* kmem_cache_free() 횟수. */
+	long long reused;               /* 공유 목록에서 받아 온 페이지 수. */
+	struct list_elem elem;          /* caches의 원소. */
+};
+
+/* Slab header, at the start of each slab page. */
+struct slab {
+	unsigned magic;                 /* SLAB_MAGIC. */
+	struct kmem_cache *cache;       /* 주인 cache. */
+	struct list_elem elem;          /* cache의 partial/full/empty 원소. */
+	size_t in_use;                  /* 나가 있는 객체 수. */
+	uint16_t free;                  /* 첫 빈 객체 번호, 없으면 FREE_END. */
+	uint16_t next[];                /* 객체마다 다음 빈 객체 번호. */
+};
+
+/* kmem_cache_create()로 만든 cache들.  cache 자체도 cache_cache에서 온다. */
+static struct kmem_cache cache_cache;
+static struct list caches;
+
+/* 어느 cache에도 속하지 않은 빈 slab 페이지.  list_elem은 페이지 맨
+   앞에 둔다.  kmem_cache_free()가 cache lock을 잡은 채로 넘기므로
+   인터럽트를 꺼서 보호한다. */
+static struct list shared_pages;
+static size_t shared_cnt;
+
+static void cache_init (struct kmem_cache *, const char *name, size_t size,
+		kmem_ctor_func *);
+
+/* Initializes the slab allocator.  palloc_init() 뒤에 부른다. */
+void
+kmem_init (void) {
+	list_init (&caches);
+	list_init (&shared_pages);
+	cache_init (&cache_cache, "kmem_cache", sizeof (struct kmem_cache), NULL);
+}
+
+/* NAME이라는 이름으로 SIZE 바이트 객체의 cache를 만들어 반환한다.
+   CTOR는 null이어도 된다.  메모리가 없으면 null. */
+struct kmem_cache *
+kmem_cache_create (const char *name, size_t size, kmem_ctor_func *ctor) {
+	struct kmem_cache *c = kmem_cache_alloc (&cache_cache);
+
+	if (c != NULL)
+		cache_init (c, name, size, ctor);
+	return c;
+}
+
+/* C를 SIZE 바이트 객체의 cache로 초기화하고 caches에 넣는다. */
+static void
+cache_init (struct kmem_cache *c, const char *name, size_t size,
+		kmem_ctor_func *ctor) {
+	size_t obj_size = ROUND_UP (size > 0 ? size : 1, sizeof (void *));
+	size_t obj_cnt = (PGSIZE - sizeof (struct slab))
+		/ (obj_size + sizeof (uint16_t));
+
+	while (ROUND_UP (sizeof (struct slab) + obj_cnt * sizeof (uint16_t),
+				sizeof (void *)) + obj_cnt * obj_size > PGSIZE)
+		obj_cnt--;
+	ASSERT (obj_cnt > 0 && obj_cnt < FREE_END);
+
+	strlcpy (c->name, name, sizeof c->name);
+	c->obj_size = obj_size;
+	c->obj_cnt = obj_cnt;
+	c->obj_ofs = ROUND_UP (sizeof (struct slab) + obj_cnt * sizeof (uint16_t),
+			sizeof (void *));
+	c->ctor = ctor;
+	lock_init (&c->lock);
+	lock_set_name (&c->lock, "slab %s", name);
+	list_init (&c->partial);
+	list_init (&c->full);
+	list_init (&c->empty);
+	c->empty_cnt = 0;
+	c->slab_cnt = 0;
+	c->in_use = 0;
+	c->allocs = c->frees = c->reused = 0;
+	list_push_back (&caches, &c->elem);
+}
+
+/* Returns the IDX'th object in slab S. */
+static void *
+slab_obj (struct slab *s, size_t idx) {
+	return (uint8_t *) s + s->cache->obj_ofs + idx * s->cache->obj_size;
+}
+
+/* Returns the slab that OBJ belongs to. */
+static struct slab *
+obj_to_slab (void *obj) {
+	struct slab *s = pg_round_down (obj);
+
+	ASSERT (s->magic == SLAB_MAGIC);
+	ASSERT ((pg_ofs (obj) - s->cache->obj_ofs) % s->cache->obj_size == 0);
+	return s;
+}
+
+/* C를 위한 새 slab을 만든다.  공유 목록의 페이지를 먼저 쓴다.
+   C의 lock을 잡은 채로 부른다. */
+static struct slab *
+slab_create (struct kmem_cache *c) {
+	struct slab *s = NULL;
+	enum intr_level old_level;
+
+	old_level = intr_disable ();
+	if (!list_empty (&shared_pages)) {
+		s = (struct slab *) list_pop_front (&shared_pages);
+		shared_cnt--;
+		c->reused++;
+	}
+	intr_set_level (old_level);
+
+	if (s == NULL) {
+		s = palloc_get_page (0);
+		if (s == NULL)
+			return NULL;
+	}
+
+	s->magic = SLAB_MAGIC;
+	s->cache = c;
+	s->in_use = 0;
+	s->free = 0;
+	for (size_t i = 0; i < c->obj_cnt; i++) {
+		s->next[i] = i + 1 < c->obj_cnt ? i + 1 : FREE_END;
+		if (c->ctor != NULL)
+			c->ctor (slab_obj (s, i));
+	}
+	c->slab_cnt++;
+	return s;
+}
+
+/* 빈 slab S를 C에서 떼어 공유 목록이나 palloc에 돌려준다.
+   C의 lock을 잡은 채로 부른다. */
+static void
+slab_release (struct kmem_cache *c, struct slab *s) {
+	enum intr_level old_level;
+
+	ASSERT (s->in_use == 0);
+	list_remove (&s->elem);
+	c->slab_cnt--;
+	s->magic = 0;
+
+	old_level = intr_disable ();
+	if (shared_cnt < SHARED_PAGES_MAX) {
+		list_push_front (&shared_pages, (struct list_elem *) s);
+		shared_cnt++;
+		s = NULL;
+	}
+	intr_set_level (old_level);
+
+	if (s != NULL)
+		palloc_free_page (s);
+}
+
+/* C에서 객체 하나를 받아 반환한다.  메모리가 없으면 null. */
+void *
+kmem_cache_alloc (struct kmem_cache *c) {
+	struct slab *s;
+	void *obj;
+
+	lock_acquire (&c->lock);
+	if (!list_empty (&c->partial))
+		s = list_entry (list_front (&c->partial), struct slab, elem);
+	else if (!list_empty (&c->empty)) {
+		s = list_entry (list_pop_front (&c->empty), struct slab, elem);
+		c->empty_cnt--;
+		list_push_front (&c->partial, &s->elem);
+	} else {
+		s = slab_create (c);
+		if (s == NULL) {
+			lock_release (&c->lock);
+			return NULL;
+		}
+		list_push_front (&c->partial, &s->elem);
+	}
+
+	ASSERT (s->free != FREE_END);
+	obj = slab_obj (s, s->free);
+	s->free = s->next[s->free];
+	if (++s->in_use == c->obj_cnt) {
+		list_remove (&s->elem);
+		list_push_front (&c->full, &s->elem);
+	}
+	c->in_use++;
+	c->allocs++;
+	lock_release (&c->lock);
+	return obj;
+}
+
+/* C에서 받은 OBJ를 돌려준다.  OBJ가 null이면 아무것도 하지 않는다. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj) {
+	struct slab *s;
+	size_t idx;
+
+	if (obj == NULL)
+		return;
+	s = obj_to_slab (obj);
+	ASSERT (s->cache == c);
+	idx = (pg_ofs (obj) - c->obj_ofs) / c->obj_size;
+
+#ifndef NDEBUG
+	/* 해제 후 사용을 잡기 위해 지운다.  CTOR로 만든 상태는 남겨 둔다. */
+	if (c->ctor == NULL)
+		memset (obj, 0xcc, c->obj_size);
+#endif
+
+	lock_acquire (&c->lock);
+	s->next[idx] = s->free;
+	s->free = idx;
+	if (s->in_use-- == c->obj_cnt) {
+		list_remove (&s->elem);
+		list_push_front (&c->partial, &s->elem);
+	}
+	if (s->in_use == 0) {
+		if (c->empty_cnt < CACHE_EMPTY_MAX) {
+			list_remove (&s->elem);
+			list_push_front (&c->empty, &s->elem);
+			c->empty_cnt++;
+		} else
+			slab_release (c, s);
+	}
+	c->in_use--;
+	c->frees++;
+	lock_release (&c->lock);
+}
+
+/* Prints slab statistics: cache마다 객체 크기, 쓰는 객체 수와 담을 수 있는
+   객체 수, slab 수, 할당과 해제 횟수, 다른 cache에서 받아 온 페이지 수,
+   그리고 slab 페이지 중 실제로 객체가 차지한 비율. */
+void
+kmem_print_stats (void) {
+	struct list_elem *e;
+
+	for (e = list_begin (&caches); e != list_end (&caches); e = list_next (e)) {
+		struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+		size_t used = c->slab_cnt != 0
+			? c->in_use * c->obj_size * 100 / (c->slab_cnt * PGSIZE) : 0;
+
+		printf ("slab: %s: %zu B objects, %zu of %zu in use in %zu slabs, "
+				"%zu%% of slab memory used, %lld allocs, %lld frees, "
+				"%lld pages reused\n",
+				c->name, c->obj_size, c->in_use, c->slab_cnt * c->obj_cnt,
+				c->slab_cnt, used, c->allocs, c->frees, c->reused);
+	}
+	printf ("slab: %zu shared empty pages\n", shared_cnt);
+}
@@ -14,11 +14,62 @@
 */
 
 #include "threads/synch.h"
+#include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/thread.h"
+#include "devices/timer.h"
+#include "intrinsic.h"
+
+static bool waiter_less (const struct rb_elem *, const struct rb_elem *,
+		void *aux);
+static void waiter_add (struct rb_tree *, struct thread *);
+static struct thread *waiter_pop (struct rb_tree *);
+static bool lock_acquire_until (struct lock *, bool timed, int64_t deadline);
+
+/* semaphore와 condition의 waiters 순서: 우선순위가 높은 스레드가 앞.
+   같은 우선순위끼리는 rb_insert()가 뒤에 넣으므로 온 순서가 된다.
+   donation으로 우선순위가 바뀌면 thread_change_priority()가 자리를 옮긴다. */
+static bool
+waiter_less (const struct rb_elem *a_, const struct rb_elem *b_,
+		void *aux UNUSED) {
+	const struct thread *a = rb_entry (a_, struct thread, wait_elem);
+	const struct thread *b = rb_entry (b_, struct thread, wait_elem);
+	return a->priority > b->priority;
+}
 
+/* T를 WAITERS에 넣는다: O(log n).  T가 락을 기다리는 중이면 줄을 설
+   때마다 (sema_up()에 깨어났다가 다른 스레드에게 락을 뺏겨 다시 설 때도)
+   holder에게 donation한다.  인터럽트가 꺼진 채로 호출. */
+static void
+waiter_add (struct rb_tree *waiters, struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (t->wait_tree == NULL);
+
+	t->wait_tree = waiters;
+	rb_insert (waiters, &t->wait_elem);
+	if (t->want_lock != NULL && !thread_mlfqs)
+		donation_priority (t->want_lock);
+}
+
+/* WAITERS에서 가장 앞의 스레드를 꺼낸다: O(log n).  비어있으면 NULL.
+   인터럽트가 꺼진 채로 호출. */
+static struct thread *
+waiter_pop (struct rb_tree *waiters) {
+	struct rb_elem *e = rb_first (waiters);
+	struct thread *t;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (e == NULL)
+		return NULL;
+	rb_remove (waiters, e);
+	t = rb_entry (e, struct thread, wait_elem);
+	t->wait_tree = NULL;
+	return t;
+}
 
 /* 세마포어 SEMA를 VALUE로 초기화
    세마포어는 음수가 아닌 정수와 그 값을 조작하는
@@ -33,7 +84,7 @@ sema_init (struct semaphore *sema, unsigned value) {
 	ASSERT (sema != NULL);
 
 	sema->value = value;
-	list_init (&sema->waiters);		// 세마리스트 초기화
+	rb_init (&sema->waiters, waiter_less, NULL);	// 세마 waiters 초기화
 }
 
 /* 세마포어에 대한 Down or "P" 연산
@@ -52,13 +103,51 @@ sema_down (struct semaphore *sema) {
 	old_level = intr_disable ();	// 인터럽트 비활성화
 
 	while (sema->value == 0) {
-		list_push_back(&sema->waiters, &run_curr->elem);
-		thread_block ();	// 세마 = 0일 때, 요청 들어오면 세마리스트에 추가 후 block 처리
+		waiter_add (&sema->waiters, run_curr);
+		thread_block ();	// 세마 = 0일 때, 요청 들어오면 waiters에 추가 후 block 처리
 	}
 	sema->value--;			// sema = 1일 때
 	intr_set_level (old_level);		// 인터럽트 상태 반환
 }
 
+/* sema_down()과 같지만 timer tick DEADLINE까지만 기다린다.
+   값을 줄였으면 true, DEADLINE이 지났으면 false.  인터럽트가 꺼진 채로 호출. */
+static bool
+sema_down_until (struct semaphore *sema, int64_t deadline) {
+	struct thread *curr = thread_current ();
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	while (sema->value == 0) {
+		if (timer_ticks () >= deadline)
+			return false;
+		/* waiters와 timing wheel 양쪽에 들어가고, 먼저 깨운 쪽이
+		   다른 쪽에서 뺀다.  시간이 다 되어 깨어났어도 그 사이 값이
+		   올라갔을 수 있으니 다시 확인한다. */
+		waiter_add (&sema->waiters, curr);
+		thread_block_until (deadline);
+	}
+	sema->value--;
+	return true;
+}
+
+/* sema_down()과 같지만 최대 TICKS timer tick까지만 기다린다.
+   값을 줄였으면 true, 시간이 다 되었으면 false.  TICKS가 0 이하면
+   sema_try_down()과 같다.  인터럽트 핸들러에서 부르면 안 된다. */
+bool
+sema_down_timeout (struct semaphore *sema, int64_t ticks) {
+	enum intr_level old_level;
+	bool success;
+
+	ASSERT (sema != NULL);
+	ASSERT (!intr_context ());
+
+	old_level = intr_disable ();
+	success = sema_down_until (sema, timer_ticks () + ticks);
+	intr_set_level (old_level);
+	return success;
+}
+
 /* 세마포에 대한 "P" 연산 또는 감소 연산을 수행하되, 세마포가 이미 0이 아닌 경우에만 수행한다. 
    세마포가 감소되면 true를 반환하고, 그렇지 않으면 false를 반환
 
@@ -93,13 +182,10 @@ sema_up (struct semaphore *sema) {
 	ASSERT (sema != NULL);
 
 	old_level = intr_disable ();
-	struct thread *next = NULL;
-	if (!list_empty (&sema->waiters))	{// waiters에 들어있을 때
-		list_sort(&sema->waiters, compare_priority, NULL);
-		next = list_entry (list_pop_front (&sema->waiters),
-					struct thread, elem);
+	// 우선순위가 가장 높은 (같으면 먼저 온) 스레드는 waiters의 맨 앞: O(log n)
+	struct thread *next = waiter_pop (&sema->waiters);
+	if (next != NULL)
 		thread_unblock (next);	// unblock처리 -> ready list로 옮겨줌
-	}
 
 	sema->value++;	// sema 값 증가
 	if (next && next->priority > thread_current()->priority && !intr_context()) {
@@ -142,6 +228,138 @@ sema_test_helper (void *sema_) {
 	}
 }
 
+#ifdef LOCKSTAT
+/* Lock contention statistics.  synch.h의 설명 참고.
+   class 표와 카운터는 인터럽트를 끄고 고친다. */
+
+#define LOCKSTAT_CLASSES 64         /* class 표의 크기 */
+
+static struct lock_class lock_classes[LOCKSTAT_CLASSES];
+static int lock_class_cnt;
+static int lock_class_dropped;      /* 표가 꽉 차서 통계 없이 만든 class 수 */
+
+/* 이름이 NAME인 (NAME이 NULL이면 SITE에서 만든) class.
+   없으면 새로 만들고, 표가 꽉 찼으면 NULL. */
+static struct lock_class *
+lockstat_class (const char *name, void *site) {
+	struct lock_class *c = NULL;
+	enum intr_level old_level = intr_disable ();
+
+	for (int i = 0; i < lock_class_cnt; i++)
+		if (name != NULL ? !strcmp (lock_classes[i].name, name)
+				: lock_classes[i].name[0] == '\0' && lock_classes[i].site == site) {
+			c = &lock_classes[i];
+			break;
+		}
+	if (c == NULL) {
+		if (lock_class_cnt < LOCKSTAT_CLASSES) {
+			c = &lock_classes[lock_class_cnt++];
+			memset (c, 0, sizeof *c);
+			if (name != NULL)
+				strlcpy (c->name, name, sizeof c->name);
+			else
+				c->site = site;
+		} else
+			lock_class_dropped++;
+	}
+	intr_set_level (old_level);
+	return c;
+}
+
+/* LOCK을 잡았다.  WAITED면 holder가 있어 START부터 기다렸다.
+   인터럽트가 꺼진 채로 호출. */
+static void
+lockstat_acquired (struct lock *lock, bool waited, uint64_t start) {
+	struct lock_class *c = lock->class;
+	uint64_t now = rdtsc ();
+
+	lock->acquired_at = now;
+	if (c == NULL)
+		return;
+	c->acquired++;
+	if (waited) {
+		uint64_t wait = now - start;
+		c->contended++;
+		c->wait_total += wait;
+		if (wait > c->wait_max)
+			c->wait_max = wait;
+	}
+}
+
+/* LOCK을 놓는다.  인터럽트가 꺼진 채로 호출. */
+static void
+lockstat_released (struct lock *lock) {
+	struct lock_class *c = lock->class;
+	uint64_t hold;
+
+	if (c == NULL)
+		return;
+	hold = rdtsc () - lock->acquired_at;
+	c->hold_total += hold;
+	if (hold > c->hold_max)
+		c->hold_max = hold;
+}
+
+/* LOCK의 통계를 FORMAT으로 만든 이름의 class로 모은다.
+   같은 이름의 락들은 한 class를 같이 쓴다.  LOCK을 잡기 전에 부른다. */
+void
+lock_set_name (struct lock *lock, const char *format, ...) {
+	char name[sizeof lock->class->name];
+	va_list args;
+
+	ASSERT (lock != NULL);
+	ASSERT (lock->holder == NULL);
+
+	va_start (args, format);
+	vsnprintf (name, sizeof name, format, args);
+	va_end (args);
+	lock->class = lockstat_class (name, NULL);
+}
+
+/* 한 번이라도 잡힌 class를 기다린 시간의 합이 큰 순서로 출력한다. */
+void
+lockstat_print (void) {
+	static struct lock_class *sorted[LOCKSTAT_CLASSES];
+	enum intr_level old_level;
+	int cnt = 0;
+
+	/* 정렬하는 동안 class가 늘지 않도록 인터럽트를 끈다. */
+	old_level = intr_disable ();
+	for (int i = 0; i < lock_class_cnt; i++) {
+		struct lock_class *c = &lock_classes[i];
+		int j;
+
+		if (c->acquired == 0)
+			continue;
+		for (j = cnt; j > 0 && (sorted[j - 1]->wait_total < c->wait_total
+					|| (sorted[j - 1]->wait_total == c->wait_total
+						&& sorted[j - 1]->acquired < c->acquired)); j--)
+			sorted[j] = sorted[j - 1];
+		sorted[j] = c;
+		cnt++;
+	}
+	intr_set_level (old_level);
+
+	printf ("Lock statistics (cycles):\n");
+	printf ("%-24s %10s %10s %12s %12s %12s %12s\n", "class", "acquired",
+			"contended", "wait-avg", "wait-max", "hold-avg", "hold-max");
+	for (int i = 0; i < cnt; i++) {
+		struct lock_class *c = sorted[i];
+		char site[24];
+
+		if (c->name[0] == '\0')
+			snprintf (site, sizeof site, "%p", c->site);
+		printf ("%-24s %10lld %10lld %12llu %12llu %12llu %12llu\n",
+				c->name[0] != '\0' ? c->name : site, c->acquired, c->contended,
+				c->contended > 0 ? c->wait_total / c->contended : 0, c->wait_max,
+				c->hold_total / c->acquired, c->hold_max);
+	}
+	if (lock_class_dropped > 0)
+		printf ("%d lock classes did not fit in the table.\n",
+				lock_class_dropped);
+}
+#endif /* LOCKSTAT */
+
 /* 락(LOCK)을 초기화합니다. 락은 언제나 최대 하나의 스레드만 보유할 수 있습니다.
 우리의 락은 '재귀적'이지 않습니다.
 즉, 현재 락을 보유한 스레드가 해당 락을 다시 얻으려고 시도하는 것은 오류입니다.
@@ -159,6 +377,23 @@ lock_init (struct lock *lock) {
 
 	lock->holder = NULL;
 	sema_init (&lock->semaphore, 1);
+	lock->donation.priority = -1;
+#ifdef LOCKSTAT
+	lock->class = lockstat_class (NULL, __builtin_return_address (0));
+	lock->acquired_at = 0;
+#endif
+}
+
+/* 현재 스레드가 LOCK을 얻었다.  holder로 기록하고, 아직 기다리는
+   스레드가 있으면 그 중 최고 우선순위를 넘겨받는다.  인터럽트가 꺼진 채로 호출. */
+static void
+lock_take (struct lock *lock) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (lock->donation.priority == -1);
+
+	lock->holder = thread_current ();
+	if (!thread_mlfqs)
+		donation_priority (lock);
 }
 
 
@@ -170,34 +405,62 @@ lock_init (struct lock *lock) {
  * 대기가 필요한 경우 인터럽트가 다시 활성화됩니다. */
 void
 lock_acquire (struct lock *lock) {
+	lock_acquire_until (lock, false, 0);
+}
 
+/* lock_acquire()와 같지만 최대 TICKS timer tick까지만 기다린다.
+   잡았으면 true, 시간이 다 되었으면 false.  시간이 다 되면 기다리는 동안
+   holder에게 넘긴 donation도 거둬들인다. */
+bool
+lock_acquire_timeout (struct lock *lock, int64_t ticks) {
+	return lock_acquire_until (lock, true, timer_ticks () + ticks);
+}
+
+/* lock_acquire()와 lock_acquire_timeout()의 본체.
+   TIMED면 timer tick DEADLINE까지만 기다린다. */
+static bool
+lock_acquire_until (struct lock *lock, bool timed, int64_t deadline) {
 	struct thread *curr = thread_current();
+	enum intr_level old_level;
+	bool waited, acquired;
 
 	ASSERT (lock != NULL);
 	ASSERT (!intr_context ());
 	ASSERT (!lock_held_by_current_thread (lock));
 
-	if (lock->holder) {
+#ifdef LOCKSTAT
+	uint64_t start = rdtsc ();
+#endif
+	/* holder 확인부터 holder 기록까지 끊기지 않도록 인터럽트를 끈다. */
+	old_level = intr_disable ();
+	waited = lock->holder != NULL;
+	/* want_lock이 설정되어 있으면 waiters에 들어갈 때 holder에게 내
+	   우선순위를 넘긴다 (waiter_add()).  MLFQS에서는 donation하지 않는다. */
+	if (waited)
 		curr->want_lock = lock;	// acquire 요청한 스레드의 want_lock 설정
-		/* lock->holder->donate_priority < curr->priority
-			curr가 실행되고 있다는 자체로 lock holder보다
-			우선순위가 높다는 뜻이기 때문에 이 조건은 없어도 됨 */
-		list_push_back(&lock->holder->donation_list, &curr->d_elem);
-		donation_priority();
-	}
 	// sema_down을 기점으로 이전은 lock을 얻기 전, 이후는 lock을 얻은 후
-	sema_down (&lock->semaphore);
-
-	curr->want_lock = NULL;
-	lock->holder = curr;
-	// waiters에서 최댓값 뽑아서 holder에게 donation
-	if (!list_empty(&lock->semaphore.waiters)) {
-		struct thread *max_t = list_entry(list_min(&lock->semaphore.waiters, compare_priority, 0), struct thread, elem);
-		if (lock->holder->origin_priority < max_t->priority) {
-			list_push_back(&lock->holder->donation_list, &max_t->d_elem);
-			lock->holder->priority = max_t->priority;
-		}
+	if (timed)
+		acquired = sema_down_until (&lock->semaphore, deadline);
+	else {
+		sema_down (&lock->semaphore);
+		acquired = true;
+	}
+
+	if (waited) {
+		curr->want_lock = NULL;
+		// 포기했으면 holder에게 넘긴 내 우선순위를 거둬들인다
+		if (!acquired && !thread_mlfqs)
+			donation_priority (lock);
 	}
+	if (acquired) {
+		// 남은 waiter들의 최고 우선순위를 넘겨받는다
+		lock_take (lock);
+#ifdef LOCKSTAT
+		lockstat_acquired (lock, waited, start);
+#endif
+	}
+	intr_set_level (old_level);
+	return acquired;
 }
 
 
@@ -207,14 +470,21 @@ lock_acquire (struct lock *lock) {
  * 이 함수는 대기하지 않으므로 인터럽트 핸들러 내에서 호출될 수 있습니다. */
 bool
 lock_try_acquire (struct lock *lock) {
+	enum intr_level old_level;
 	bool success;
 
 	ASSERT (lock != NULL);
 	ASSERT (!lock_held_by_current_thread (lock));
 
+	old_level = intr_disable ();
 	success = sema_try_down (&lock->semaphore);
-	if (success)
-		lock->holder = thread_current ();
+	if (success) {
+		lock_take (lock);
+#ifdef LOCKSTAT
+		lockstat_acquired (lock, false, 0);
+#endif
+	}
+	intr_set_level (old_level);
 	return success;
 }
 
@@ -224,19 +494,31 @@ lock_try_acquire (struct lock *lock) {
  * 스레드가 priority를 양도받아 critical section을 마치고 lock을 반환할 때의 경우 */
 void
 lock_release (struct lock *lock) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
 	ASSERT (lock != NULL);
 	ASSERT (lock_held_by_current_thread (lock));
 
-	remove_thread_in_donation_list(lock);	// 1)
-	reset_priority();						// 2)
+	/* sema_up해서 lock의 점유를 반환하기 전에
+	이 lock의 waiter들에게서 받은 donation을 1)donations에서 빼고
+	2)남은 donation과 origin_priority 중 큰 값으로 priority를 재설정: O(log n)
+	waiter들은 semaphore의 waiters에 그대로 남아 다음 holder가 넘겨받는다. */
+	old_level = intr_disable ();
+	if (!thread_mlfqs) {
+		if (lock->donation.priority >= 0) {
+			rb_remove (&curr->donations, &lock->donation.elem);	// 1)
+			lock->donation.priority = -1;
+		}
+		reset_priority();						// 2)
+	}
 
+#ifdef LOCKSTAT
+	lockstat_released (lock);
+#endif
 	lock->holder = NULL;
-	/* sema_up해서 lock의 점유를 반환하기 전에
-	현재 이 lock을 사용하기 위해 나에게 priority를 빌려준 스레드들을
-	1)donalist에서 제거하고 2)priority를 재설정해주는 작업 필요
-	이 땐 남아있는 donalist에서 가장 높은 priority를 받아서 설정해야함
-	만약 donalist 비어있으면 origin_priority로 설정 */
 	sema_up (&lock->semaphore);
+	intr_set_level (old_level);
 }
 
 /* 현재 스레드가 LOCK을 보유하고 있는 경우 true를 반환하고, 그렇지 않으면 false를 반환
@@ -249,12 +531,158 @@ lock_held_by_current_thread (const struct lock *lock) {
 	return lock->holder == thread_current ();
 }
 
-/* list 내의 하나의 세마포어(semaphore) */
-struct semaphore_elem {
-	struct list_elem elem;              /* List element. */
-	struct semaphore semaphore;         /* This semaphore. */
-};
+/* Reader-writer lock.  synch.h의 설명 참고. */
+
+/* T가 RW를 읽기로 잡고 있는 rw_reader.  없으면 NULL */
+static struct rw_reader *
+rw_reader_find (struct thread *t, struct rwlock *rw) {
+	struct list_elem *e;
+
+	for (e = list_begin (&t->rw_reads); e != list_end (&t->rw_reads);
+			e = list_next (e)) {
+		struct rw_reader *r = list_entry (e, struct rw_reader, thread_elem);
+		if (r->rw == rw)
+			return r;
+	}
+	return NULL;
+}
+
+/* RW를 아무도 잡지 않은 상태로 초기화 */
+void
+rw_init (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	lock_init (&rw->lock);
+	rw->readers = 0;
+	list_init (&rw->reader_list);
+	rw->draining = false;
+	sema_init (&rw->drained, 0);
+}
+
+/* RW를 읽기로 잡는다.  writer가 잡고 있거나 기다리고 있으면 그 writer가
+   끝날 때까지 LOCK에서 기다린다 (writer에게 donation).  이미 읽기로 잡고
+   있으면 기다리지 않고 횟수만 센다: 뒤에 온 writer 때문에 LOCK에서 기다리면
+   그 writer는 내가 나가기를 기다리므로 교착이 된다.
+   인터럽트 핸들러에서 부를 수 없다. */
+void
+rw_read_acquire (struct rwlock *rw) {
+	struct thread *curr = thread_current ();
+	struct rw_reader *r;
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+
+	r = rw_reader_find (curr, rw);
+	if (r != NULL) {
+		r->depth++;
+		return;
+	}
+
+	/* 보통은 하나만 잡으므로 struct thread 안의 칸을 먼저 쓴다. */
+	if (curr->rw_read.rw == NULL)
+		r = &curr->rw_read;
+	else {
+		r = malloc (sizeof *r);
+		if (r == NULL)
+			PANIC ("rw_read_acquire: out of memory");
+	}
+
+	lock_acquire (&rw->lock);
+	old_level = intr_disable ();
+	r->rw = rw;
+	r->thread = curr;
+	r->depth = 1;
+	r->donation.priority = -1;
+	list_push_back (&rw->reader_list, &r->elem);
+	list_push_back (&curr->rw_reads, &r->thread_elem);
+	rw->readers++;
+	intr_set_level (old_level);
+	lock_release (&rw->lock);
+}
+
+/* 현재 스레드가 읽기로 잡고 있는 RW를 놓는다.  마지막 reader이고 writer가
+   기다리고 있으면 깨운다. */
+void
+rw_read_release (struct rwlock *rw) {
+	struct thread *curr = thread_current ();
+	struct rw_reader *r;
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	r = rw_reader_find (curr, rw);
+	ASSERT (r != NULL);
+	if (--r->depth > 0)
+		return;
+
+	old_level = intr_disable ();
+	list_remove (&r->elem);
+	list_remove (&r->thread_elem);
+	r->rw = NULL;
+	if (r->donation.priority >= 0) {
+		/* writer에게서 받은 donation 반납 */
+		rb_remove (&curr->donations, &r->donation.elem);
+		r->donation.priority = -1;
+		reset_priority ();
+	}
+	if (--rw->readers == 0 && rw->draining) {
+		rw->draining = false;
+		sema_up (&rw->drained);
+	}
+	intr_set_level (old_level);
+
+	if (r != &curr->rw_read)
+		free (r);
+}
+
+/* RW를 쓰기로 잡는다.  LOCK을 잡아 새 reader를 막고, 이미 읽고 있는
+   reader들에게 우선순위를 donation하며 그들이 나가기를 기다린다.
+   인터럽트 핸들러에서 부를 수 없다. */
+void
+rw_write_acquire (struct rwlock *rw) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
 
+	ASSERT (rw != NULL);
+	ASSERT (rw_reader_find (curr, rw) == NULL);
+
+	lock_acquire (&rw->lock);
+	old_level = intr_disable ();
+	while (rw->readers > 0) {
+		rw->draining = true;
+		curr->drain_rw = rw;
+		if (!thread_mlfqs)
+			rw_donate_readers (rw);
+		sema_down (&rw->drained);
+	}
+	curr->drain_rw = NULL;
+	intr_set_level (old_level);
+}
+
+/* 현재 스레드가 쓰기로 잡고 있는 RW를 놓는다. */
+void
+rw_write_release (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	lock_release (&rw->lock);
+}
+
+/* reader들이 나가기를 기다리는 writer의 우선순위를 RW의 모든 reader에게
+   넘긴다.  writer가 기다리지 않으면 넘겨둔 것을 거둔다.
+   인터럽트가 꺼진 채로 호출. */
+void
+rw_donate_readers (struct rwlock *rw) {
+	int top = rw->draining ? rw->lock.holder->priority : -1;
+	struct list_elem *e;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	for (e = list_begin (&rw->reader_list); e != list_end (&rw->reader_list);
+			e = list_next (e)) {
+		struct rw_reader *r = list_entry (e, struct rw_reader, elem);
+		donation_update (r->thread, &r->donation, top);
+	}
+}
 
 /* COND(condition variable) 초기화
   조건 변수는 하나의 코드 조각이 조건을 신호로 보내고,
@@ -263,21 +691,7 @@ void
 cond_init (struct condition *cond) {
 	ASSERT (cond != NULL);
 
-	list_init (&cond->waiters);
-}
-
-/* 세마포어 비교 함수 */
-bool
-cond_compare_priority (const struct list_elem *a, const struct list_elem *b, UNUSED void *aux) {
-	// 세마 elem을 가리키는 포인터 선언 후 초기화
-	struct semaphore_elem *sema_a = list_entry(a, struct semaphore_elem, elem);
-	struct semaphore_elem *sema_b = list_entry(b, struct semaphore_elem, elem);
-	
-	// 각 세마포어 요소에서 대기중인 스레드 목록의 첫 번째 요소 얻기
-	struct thread *thread_a = list_entry(list_begin(&sema_a->semaphore.waiters), struct thread, elem);
-	struct thread *thread_b = list_entry(list_begin(&sema_b->semaphore.waiters), struct thread, elem);
-    
-	return thread_a->priority > thread_b->priority;
+	rb_init (&cond->waiters, waiter_less, NULL);
 }
 
 /* 이 함수는 LOCK을 원자적으로 해제하고 다른 코드에 의해 COND가 신호를 받을 때까지 기다린 다음, 
@@ -294,21 +708,54 @@ cond_compare_priority (const struct list_elem *a, const struct list_elem *b, UNU
   필요한 경우 잠들어야하면 인터럽트가 다시 켜질 수 있습니다. */
 void
 cond_wait (struct condition *cond, struct lock *lock) {
-	struct semaphore_elem waiter;
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
 
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
 	ASSERT (!intr_context ());
 	ASSERT (lock_held_by_current_thread (lock));
 
-	sema_init (&waiter.semaphore, 0);
-	list_insert_ordered(&cond->waiters, &waiter.elem, cond_compare_priority, NULL);
-	// list_push_back (&cond->waiters, &waiter.elem);
+	/* waiters에 넣고 block할 때까지 인터럽트를 꺼서 signal을 놓치지 않는다.
+	   lock_release()에서 더 높은 waiter에게 양보하면 ready인 채로 waiters에
+	   남는데, 그 사이 signal을 받았으면 (wait_tree == NULL) block하지 않는다. */
+	old_level = intr_disable ();
+	waiter_add (&cond->waiters, curr);
 	lock_release (lock);
-	sema_down (&waiter.semaphore);
+	if (curr->wait_tree != NULL)
+		thread_block ();
+	intr_set_level (old_level);
 	lock_acquire (lock);
 }
 
+/* cond_wait()과 같지만 최대 TICKS timer tick까지만 기다린다.
+   signal을 받았으면 true, 시간이 다 되었으면 false.  어느 쪽이든
+   LOCK을 다시 잡고 돌아온다 (LOCK을 기다리는 시간은 TICKS에 들지 않는다). */
+bool
+cond_wait_timeout (struct condition *cond, struct lock *lock, int64_t ticks) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+	int64_t deadline;
+	bool signaled = true;
+
+	ASSERT (cond != NULL);
+	ASSERT (lock != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (lock_held_by_current_thread (lock));
+
+	deadline = timer_ticks () + ticks;
+	old_level = intr_disable ();
+	waiter_add (&cond->waiters, curr);
+	lock_release (lock);
+	/* cond_wait()과 같은 이유로 아직 waiters에 있을 때만 block한다.
+	   signal과 timing wheel 중 먼저 깨운 쪽이 다른 쪽에서 뺀다. */
+	if (curr->wait_tree != NULL)
+		signaled = thread_block_until (deadline);
+	intr_set_level (old_level);
+	lock_acquire (lock);
+	return signaled;
+}
+
 /* 만약 어떤 스레드가 LOCK에 의해 보호되는 COND에서 기다리고 있다면, 
    이 함수는 그 중 하나에게 신호를 보내 대기 상태에서 깨어나도록 합니다.
    이 함수를 호출하기 전에 LOCK이 보유되어야 합니다.
@@ -317,15 +764,25 @@ cond_wait (struct condition *cond, struct lock *lock) {
    조건 변수에 신호를 보내려고 시도하는 것은 의미가 없습니다.. */
 void
 cond_signal (struct condition *cond, struct lock *lock UNUSED) {
+	enum intr_level old_level;
+	struct thread *next;
+
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
 	ASSERT (!intr_context ());
 	ASSERT (lock_held_by_current_thread (lock));
 
-	if (!list_empty (&cond->waiters))
-		list_sort(&cond->waiters, cond_compare_priority, NULL);
-		sema_up (&list_entry (list_pop_front (&cond->waiters),
-					struct semaphore_elem, elem)->semaphore);
+	// 우선순위가 가장 높은 (같으면 먼저 온) waiter는 맨 앞: O(log n)
+	old_level = intr_disable ();
+	next = waiter_pop (&cond->waiters);
+	if (next != NULL) {
+		// cond_wait()에서 아직 block하기 전이면 꺼내기만 하면 된다
+		if (next->status == THREAD_BLOCKED)
+			thread_unblock (next);
+		if (next->priority > thread_current ()->priority)
+			thread_yield ();
+	}
+	intr_set_level (old_level);
 }
 
 /* 만약 어떤 스레드가 LOCK에 의해 보호되는 COND에서 기다리고 있다면,
@@ -339,6 +796,6 @@ cond_broadcast (struct condition *cond, struct lock *lock) {
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
 
-	while (!list_empty (&cond->waiters))
+	while (!rb_empty (&cond->waiters))
 		cond_signal (cond, lock);
 }
\ No newline at end of file
@@ -5,12 +5,17 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/flags.h"
+#include "threads/fpu.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
+#include "threads/rcu.h"
+#include "threads/sched.h"
 #include "threads/synch.h"
+#include "threads/switch.h"
 #include "threads/vaddr.h"
 #include "intrinsic.h"
+#include "devices/timer.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #endif
@@ -24,10 +29,36 @@
    Do not modify this value. */
 #define THREAD_BASIC 0xd42df210
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
-static struct list sleep_list;		// sleep queue
+/* thread.h 맨 위의 설명처럼 struct thread는 커널 스택과 한 페이지를
+   나눠 쓴다.  필드가 늘어 1 kB를 넘으면 빌드를 깨서 스택이 3 kB 아래로
+   줄지 않게 한다.  락이나 semaphore를 통째로 넣을 때 특히 주의. */
+_Static_assert (sizeof (struct thread) <= 1024,
+		"struct thread must stay within 1 kB to leave room for the kernel stack");
+
+/* THREAD_READY 상태, 즉 실행 준비는 되었지만 실행 중이지는 않은
+   스레드들을 담아두는 run queue.
+   안에 어떻게 담을지는 scheduler class가 정한다 (threads/sched.c).
+   CPU가 하나뿐이므로 인터럽트를 꺼서 보호한다. */
+static struct runqueue runqueue;
+
+/* Sleep queue: hierarchical timing wheel.
+   레벨 0은 1틱짜리 슬롯 256개, 레벨 1~4는 바로 아래 레벨 한 바퀴 길이의
+   슬롯 64개씩으로 구성된다.  스레드는 깨울 시간(end_tick)까지 남은 틱 수에 따라
+   한 레벨의 슬롯에 O(1)로 들어가고, 상위 레벨의 슬롯은 하위 레벨이 한 바퀴 돌 때마다
+   한 칸씩 아래 레벨로 흘러내린다(cascade).  그래서 삽입도, 매 틱의 thread_wake도
+   잠든 스레드 수와 상관없이 (분할 상환) O(1)이다. */
+#define WHEEL_ROOT_BITS 8
+#define WHEEL_LEVEL_BITS 6
+#define WHEEL_ROOT_SIZE (1 << WHEEL_ROOT_BITS)
+#define WHEEL_LEVEL_SIZE (1 << WHEEL_LEVEL_BITS)
+#define WHEEL_LEVEL_CNT 4
+/* 휠이 표현할 수 있는 가장 먼 시간 (2^32 틱), 이보다 먼 스레드는 여기에 걸어둔다. */
+#define WHEEL_MAX_TICKS (((int64_t) 1 << (WHEEL_ROOT_BITS \
+		+ WHEEL_LEVEL_CNT * WHEEL_LEVEL_BITS)) - 1)
+
+static struct list wheel_root[WHEEL_ROOT_SIZE];
+static struct list wheel_level[WHEEL_LEVEL_CNT][WHEEL_LEVEL_SIZE];
+static int64_t wheel_tick;		/* 다음에 처리할 tick, 이전 tick의 슬롯은 모두 비어있음 */
 
 /* Idle thread. */
 static struct thread *idle_thread;
@@ -41,13 +72,77 @@ static struct lock tid_lock;
 /* Thread destruction requests */
 static struct list destruction_req;
 
+/* 종료한 스레드의 페이지는 palloc에 바로 돌려주지 않고 THREAD_CACHE_MAX개까지
+   모아뒀다가 thread_create()에서 다시 쓴다.  fork가 많은 부하에서 kernel pool
+   bitmap을 매번 뒤지지 않아도 된다.  init_thread()가 struct thread를 지우므로
+   스택 부분은 0일 필요가 없지만, -zero-threads면 idle 스레드가 한가할 때
+   dirty 페이지를 0으로 채워 clean 리스트로 옮긴다.  인터럽트를 끄고 다룬다. */
+#define THREAD_CACHE_MAX 16
+struct cached_page {
+	struct list_elem elem;          /* cache_clean 또는 cache_dirty의 원소 */
+};
+static struct list cache_clean;     /* 0으로 채워진 페이지 */
+static struct list cache_dirty;     /* 종료한 스레드가 쓰던 그대로인 페이지 */
+static int cache_cnt;               /* 두 리스트의 페이지 수 합 */
+static long long cache_hits;        /* 캐시에서 꺼내 쓴 횟수 */
+static long long cache_misses;      /* palloc에서 새로 받은 횟수 */
+static long long cache_zeroed;      /* idle에서 0으로 채운 페이지 수 */
+
+/* If true, the idle thread zeroes recycled thread pages.
+   Controlled by kernel command-line option "-zero-threads". */
+bool thread_zero_pages;
+
+/* 최근에 종료된 스레드들의 통계.  top 표에서 이미 끝난 스레드도 보이도록
+   마지막 EXITED_STATS_CNT개를 원형 버퍼에 남겨둔다. */
+#define EXITED_STATS_CNT 16
+struct exited_stats {
+	tid_t tid;
+	char name[16];
+	int priority;
+	struct thread_stats stats;
+};
+static struct exited_stats exited_stats[EXITED_STATS_CNT];
+static int exited_cnt;			/* 지금까지 종료된 스레드 수 */
+
+/* Wakeup latency: thread_unblock()부터 schedule()에서 CPU를 받을 때까지의
+   TSC cycle 수를 우선순위별 log2 histogram으로 모은다.
+   latency_hist[p][i]는 우선순위 p에서 [2^i, 2^(i+1)) cycle이 걸린 횟수.
+   TIME_SLICE를 조정하거나 sema_up() 뒤의 선점이 실제로 빠른지 확인할 때 쓴다. */
+#define LATENCY_BUCKETS 64
+static unsigned latency_hist[PRI_MAX + 1][LATENCY_BUCKETS];
+static uint64_t latency_sum[PRI_MAX + 1];
+static uint64_t latency_max[PRI_MAX + 1];
+
+/* 지금까지 가장 오래 기다린 wakeup */
+static struct {
+	uint64_t cycles;
+	tid_t tid;
+	char name[16];
+	int priority;
+	tid_t waker;				/* unblock한 (또는 그때 실행 중이던) 스레드 */
+	tid_t prev_tid;				/* 그 사이 마지막으로 CPU를 쓰다 넘겨준 스레드 */
+	char prev_name[16];
+	int prev_priority;
+} latency_worst;
+
+/* 살아있는 모든 스레드의 리스트 (all_elem).
+   MLFQS에서 1초마다 recent_cpu를 감쇠할 때만 순회한다. */
+static struct list all_list;
+
+/* MLFQS 상태.
+   recent_cpu는 매 tick 실행 중인 스레드만 올리고, priority는 4 tick마다
+   실행 중인 스레드만 다시 계산한다.  다른 스레드의 priority를 바꾸는 값
+   (load_avg, 감쇠된 recent_cpu)은 1초마다만 변하므로 그때 ready queue를
+   한 번 훑어 다시 계산하고, blocked 스레드는 깨어날 때 계산한다. */
+#define MLFQS_PRI_SLICE 4       /* priority를 다시 계산하는 주기 (tick) */
+static fixed_t load_avg;        /* 시스템 load average */
+
 /* Statistics. */
 static long long idle_ticks;    /* CPU가 아무런 작업을 수행하지 않고 대기하는 시간을 측정하는 데 사용 */
 static long long kernel_ticks;  /* 커널 스레드가 CPU를 사용한 시간을 추적 (main) */
 static long long user_ticks;    /* 사용자 프로그램이 CPU를 사용한 시간을 추적 */
 
 /* Scheduling. */
-#define TIME_SLICE 4            /* # of timer ticks to give each thread. */
 static unsigned thread_ticks;   /* 마지막으로 실행된 스레드가 사용한 시간 */
 
 /* If false (default), use round-robin scheduler.
@@ -59,13 +154,26 @@ static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
 static struct thread *next_thread_to_run (void);
+static void ready_queue_push (struct thread *t);
+static void ready_queue_remove (struct thread *t);
+static int runqueue_top (struct runqueue *rq);
+static void wheel_insert (struct thread *t);
+static void wheel_cascade (int level);
 static void init_thread (struct thread *, const char *name, int priority);
+static struct thread *thread_page_get (void);
+static void thread_page_put (struct thread *t);
+static bool thread_page_zero (void);
+static void latency_record (struct thread *t, struct thread *prev, uint64_t cycles);
+static int mlfqs_priority (struct thread *t);
+static void mlfqs_update_priority (struct thread *t);
+static void mlfqs_update_ready_queues (void);
+static void mlfqs_per_second (void);
+static void print_top_line (tid_t tid, const char *name, int priority,
+		const char *state, const struct thread_stats *st);
 static void do_schedule(int status);
 static void schedule (void);
 void thread_sleep(int64_t wake_time);
 
-bool compare_priority(struct list_elem *me, struct list_elem *you, void *aux);
-bool compare_ticks(struct list_elem *me, struct list_elem *you, void *aux);
 void thread_wake(int64_t now_ticks);
 
 static tid_t allocate_tid (void);
@@ -114,15 +222,31 @@ thread_init (void) {
 
 	/* Init the globla thread context */
 	lock_init (&tid_lock);
-	list_init (&ready_list);
-	list_init (&sleep_list);
+	/* MLFQS는 priority class의 레벨별 queue를 직접 다시 계산한다. */
+	if (thread_mlfqs && sched_class != &sched_priority)
+		PANIC ("-mlfqs requires -sched=priority");
+	if (sched_slice_min < 1 || sched_slice_min > sched_slice_max)
+		PANIC ("bad time slice range %u..%u", sched_slice_min, sched_slice_max);
+	sched_class->init (&runqueue);
+	runqueue.cnt = 0;
+	for (int i = 0; i < WHEEL_ROOT_SIZE; i++)
+		list_init (&wheel_root[i]);
+	for (int level = 0; level < WHEEL_LEVEL_CNT; level++)
+		for (int i = 0; i < WHEEL_LEVEL_SIZE; i++)
+			list_init (&wheel_level[level][i]);
+	wheel_tick = 0;
 	list_init (&destruction_req);
+	list_init (&cache_clean);
+	list_init (&cache_dirty);
+	list_init (&all_list);
+	load_avg = 0;
 	
 	/* Set up a thread structure for the running thread. */
 	initial_thread = running_thread ();
 	init_thread (initial_thread, "main", PRI_DEFAULT);
 	initial_thread->status = THREAD_RUNNING;
 	initial_thread->tid = allocate_tid ();
+	initial_thread->stats_stamp = rdtsc ();
 	struct lock *lock;
 	
 }
@@ -150,6 +274,7 @@ thread_tick (void) {
 	struct thread *t = thread_current ();
 
 	/* Update statistics. */
+	t->stats.run_ticks++;
 	if (t == idle_thread)
 		idle_ticks++;
 #ifdef USERPROG
@@ -159,9 +284,32 @@ thread_tick (void) {
 	else
 		kernel_ticks++;
 
-	/* Enforce preemption. */
-	if (++thread_ticks >= TIME_SLICE)
-		intr_yield_on_return ();
+	if (thread_mlfqs) {
+		int64_t now = timer_ticks ();
+
+		if (t != idle_thread)
+			t->recent_cpu = fp_add_int (t->recent_cpu, 1);
+		if (now % TIMER_FREQ == 0)
+			mlfqs_per_second ();
+		else if (now % MLFQS_PRI_SLICE == 0)
+			mlfqs_update_priority (t);
+	}
+
+	/* Enforce preemption.  언제 선점할지는 scheduler class가 정한다. */
+	++thread_ticks;
+	if (t == idle_thread) {
+		if (thread_ticks >= TIME_SLICE)
+			intr_yield_on_return ();
+	} else {
+		if (sched_class->tick (&runqueue, t, thread_ticks))
+			intr_yield_on_return ();
+	}
+}
+
+/* 타이머가 interrupt 없이 건너뛴 CNT개의 idle tick을 통계에 반영 (-tickless) */
+void
+thread_tick_idle (int64_t cnt) {
+	idle_ticks += cnt;
 }
 
 /* Prints thread statistics. */
@@ -169,6 +317,65 @@ void
 thread_print_stats (void) {
 	printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
 			idle_ticks, kernel_ticks, user_ticks);
+	printf ("Thread: %lld page cache hits, %lld misses, %lld zeroed while idle\n",
+			cache_hits, cache_misses, cache_zeroed);
+}
+
+/* 모든 스레드와 최근에 종료된 스레드의 스케줄링 통계를 top처럼 출력.
+   ready queue에서 오래 기다린 스레드(READY)가 굶고 있는 스레드다. */
+void
+thread_print_top (void) {
+	static const char *states[] = {"run", "ready", "block", "dying"};
+	enum intr_level old_level = intr_disable ();
+	struct thread *curr = thread_current ();
+	struct list_elem *e;
+	int i, first;
+
+	/* 실행 중인 스레드의 지금까지의 실행 시간도 반영 */
+	uint64_t now = rdtsc ();
+	curr->stats.run_cycles += now - curr->stats_stamp;
+	curr->stats_stamp = now;
+
+	printf ("Thread: %5s %-16s %3s %-5s %10s %10s %10s %7s %6s %6s %5s %5s\n",
+			"TID", "NAME", "PRI", "STATE", "RUN(Kc)", "READY(Kc)", "LOCK(Kc)",
+			"TICKS", "VOL", "INVOL", "DON", "SLICE");
+	for (e = list_begin (&all_list); e != list_end (&all_list); e = list_next (e)) {
+		struct thread *t = list_entry (e, struct thread, all_elem);
+		print_top_line (t->tid, t->name, t->priority, states[t->status], &t->stats);
+	}
+
+	first = exited_cnt > EXITED_STATS_CNT ? exited_cnt - EXITED_STATS_CNT : 0;
+	for (i = first; i < exited_cnt; i++) {
+		struct exited_stats *x = &exited_stats[i % EXITED_STATS_CNT];
+		print_top_line (x->tid, x->name, x->priority, "exit", &x->stats);
+	}
+	if (first > 0)
+		printf ("Thread: (%d older exited threads not shown)\n", first);
+	intr_set_level (old_level);
+}
+
+/* top 표의 한 줄.  SLICE는 받은 time slice의 평균 길이 (tick) */
+static void
+print_top_line (tid_t tid, const char *name, int priority,
+		const char *state, const struct thread_stats *st) {
+	unsigned slice10 = st->slices > 0 ? st->slice_ticks * 10 / st->slices : 0;
+
+	printf ("Thread: %5d %-16s %3d %-5s %10llu %10llu %10llu %7lld %6u %6u %5u %3u.%u\n",
+			tid, name, priority, state, st->run_cycles / 1000,
+			st->ready_cycles / 1000, st->lock_cycles / 1000, st->run_ticks,
+			st->voluntary_switches, st->involuntary_switches, st->donations,
+			slice10 / 10, slice10 % 10);
+}
+
+/* T의 스케줄링 통계를 ST에 복사 */
+void
+thread_get_stats (struct thread *t, struct thread_stats *st) {
+	enum intr_level old_level = intr_disable ();
+
+	*st = t->stats;
+	if (t->status == THREAD_RUNNING)
+		st->run_cycles += rdtsc () - t->stats_stamp;
+	intr_set_level (old_level);
 }
 
 /* 주어진 초기 우선순위 PRIORITY로 이름이 NAME, FUNCTION을 실행하고,
@@ -192,7 +399,7 @@ thread_create (const char *name, int priority,
 	ASSERT (function != NULL);
 
 	/* Allocate thread. */
-	t = palloc_get_page (PAL_ZERO);
+	t = thread_page_get ();
 	if (t == NULL)
 		return TID_ERROR;
 
@@ -200,31 +407,27 @@ thread_create (const char *name, int priority,
 	init_thread (t, name, priority);
 	tid = t->tid = allocate_tid ();
 
-	/* Call the kernel_thread if it scheduled.
-	 * Note) rdi is 1st argument, and rsi is 2nd argument. */
-	t->tf.rip = (uintptr_t) kernel_thread;
-	t->tf.R.rdi = (uint64_t) function;
-	t->tf.R.rsi = (uint64_t) aux;
-	t->tf.ds = SEL_KDSEG;
-	t->tf.es = SEL_KDSEG;
-	t->tf.ss = SEL_KDSEG;
-	t->tf.cs = SEL_KCSEG;
-	t->tf.eflags = FLAG_IF;
+	/* MLFQS: nice와 recent_cpu는 부모에게서 물려받고 priority는 계산한다. */
+	if (thread_mlfqs) {
+		t->nice = thread_current ()->nice;
+		t->recent_cpu = thread_current ()->recent_cpu;
+		t->priority = t->origin_priority = mlfqs_priority (t);
+	}
+
+	/* 처음 switch_threads()로 전환되면 switch_entry()로 "돌아가서"
+	 * kernel_thread (function, aux)를 호출하도록 스택을 꾸민다.
+	 * switch_entry의 call 직전에 rsp가 16바이트 정렬되도록 맞춘다. */
+	struct switch_frame *sf =
+		(struct switch_frame *) ((uint8_t *) t + PGSIZE - 16) - 1;
+	sf->rbx = (uint64_t) function;
+	sf->r12 = (uint64_t) aux;
+	sf->r13 = (uint64_t) kernel_thread;
+	sf->rip = switch_entry;
+	t->rsp = (uint64_t) sf;
 	/* Add to run queue. */
 
 	t->parent = thread_current();
-
-#ifdef USERPROG
-	struct child_info *child_info = (struct child_info *) malloc(sizeof(struct child_info));
-	child_info->tid = tid;
-	child_info->exit_status = 0;
-	child_info->child_t = t;
-	child_info->exited = false;
-	list_push_back(&thread_current()->child_list, &child_info->c_elem);
-
-	t->fd_cnt = 2;                       // 표준 입출력 0,1 제외
-    t->fd_table = palloc_get_page(0);    // fd table 초기화
-#endif
+	/* child_info와 fd table은 유저 프로세스가 될 때 process_init()에서 만든다. */
 
 	thread_unblock (t);		// 자식을 ready list 에 넣기
 	if (t->priority >= thread_current()->priority)
@@ -232,90 +435,224 @@ thread_create (const char *name, int priority,
 	return tid;
 }
 
-/* sleep_list 에 삽입시 우선순위(tick 오름차순) 정렬 --> 갓벽..! */
-bool
-compare_ticks(struct list_elem *me, struct list_elem *you, void *aux) {
-	// me/you 라는 elem 을 이용해 해당 스레드의 시작점을 알기 위해 list entry 사용 (return struct thread *)
-	struct thread *me_t = list_entry(me, struct thread, elem);
-	struct thread *you_t = list_entry(you, struct thread, elem);
-	// me_t가 더 작아야지 우선순위가 높기 때문에, list_insert_ordered 함수에서 ture를 반환
-	return me_t->end_tick < you_t->end_tick;
+/* donations 순서: 우선순위가 높은 donation이 앞 */
+static bool
+donation_less (const struct rb_elem *a_, const struct rb_elem *b_,
+		void *aux UNUSED) {
+	const struct donation *a = rb_entry (a_, struct donation, elem);
+	const struct donation *b = rb_entry (b_, struct donation, elem);
+	return a->priority > b->priority;
 }
 
-/* 우선순위 비교 (숫자 클수록 우선순위 높음) */
-bool
-compare_priority(struct list_elem *me, struct list_elem *you, void *aux) {
-	struct thread *lock_holder = list_entry(me, struct thread, elem);
-	struct thread *lock_requester = list_entry(you, struct thread, elem);
-	return lock_holder->priority > lock_requester->priority;
+/* T가 기부받은 것까지 반영한 우선순위: 원래 우선순위와
+   들고 있는 락들의 최고 waiter 우선순위 중 큰 값.  O(1) */
+static int
+donated_priority (struct thread *t) {
+	struct rb_elem *e = rb_first (&t->donations);
+	int donated = e != NULL ? rb_entry (e, struct donation, elem)->priority : -1;
+	return donated > t->origin_priority ? donated : t->origin_priority;
 }
 
-/* donate 시 우선순위 비교 (숫자 클수록 우선순위 높음) */
-bool
-donate_compare_priority(struct list_elem *me, struct list_elem *you, void *aux) {
-	struct thread *lock_holder = list_entry(me, struct thread, d_elem);
-	struct thread *lock_requester = list_entry(you, struct thread, d_elem);
-	return lock_holder->priority > lock_requester->priority;
+/* LOCK을 기다리는 스레드 중 가장 높은 우선순위, 없으면 -1.  semaphore의
+   waiters는 우선순위 순이고 맨 앞을 기억하므로 O(1) */
+static int
+lock_waiter_max (struct lock *lock) {
+	struct rb_elem *e = rb_first (&lock->semaphore.waiters);
+	return e != NULL ? rb_entry (e, struct thread, wait_elem)->priority : -1;
 }
 
-/* 자신의 priority를 lock holder에게 donation 해주는 함수 */
+/* LOCK의 최고 waiter 우선순위가 바뀌었을 수 있으니 holder에게 반영한다.
+   인터럽트가 꺼진 채로 호출. */
 void
-donation_priority(void) {
-	struct thread *curr = thread_current();
+donation_priority(struct lock *lock) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (!thread_mlfqs);
 
-	while (curr->want_lock) {
-		struct thread *holder = curr->want_lock->holder;	// curr가 요청한 락의 홀더
-		if (holder->priority < curr->priority) {
-			// holder->priority = list_entry(list_min(&holder->donation_list, donate_compare_priority, 0), struct thread, d_elem)->priority;
-			holder->priority = curr->priority;	// donation, curr는 실행중이므로 이미 홀더보다 우선순위 높음
-			curr = holder;
-		}
-	}
+	if (lock != NULL && lock->holder != NULL)
+		donation_update (lock->holder, &lock->donation, lock_waiter_max (lock));
 }
 
-/* donation_list에서 스레드 지우는 함수 */
+/* HOLDER의 donations에 넣어둔 DONATION을 TOP으로 바꾼다 (-1이면 뺀다).
+   holder의 우선순위가 바뀌었고 holder도 다른 락을 기다리는 중이면
+   (그 락의 waiters 안의 자리는 thread_change_priority()가 옮긴다)
+   체인을 따라 올라간다.  rwlock의 reader들을 기다리는 writer였다면
+   reader들에게 넘긴다.  단계마다 O(log n)이고 전체는 체인 길이에
+   비례한다.  인터럽트가 꺼진 채로 호출. */
 void
-remove_thread_in_donation_list (struct lock *lock) {
-	struct list_elem *delem;
-
-	for (delem=list_begin(&lock->holder->donation_list);
-		delem!=list_end(&lock->holder->donation_list); delem=list_next(delem)) {
-			struct thread *remove_t = list_entry(delem, struct thread, d_elem);	// 삭제할 스레드
-			if (remove_t->want_lock == lock)
-				list_remove(delem);
+donation_update (struct thread *holder, struct donation *donation, int top) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (!thread_mlfqs);
+
+	for (;;) {
+		struct lock *lock;
+		int old_priority, new_priority;
+
+		if (top == donation->priority)
+			return;
+		if (donation->priority >= 0)
+			rb_remove (&holder->donations, &donation->elem);
+		donation->priority = top;
+		if (top >= 0)
+			rb_insert (&holder->donations, &donation->elem);
+
+		old_priority = holder->priority;
+		new_priority = donated_priority (holder);
+		if (new_priority == old_priority)
+			return;
+		// donation, holder가 ready 상태라면 run queue의 레벨도 같이 옮겨줌
+		thread_change_priority (holder, new_priority);
+		if (new_priority > old_priority)
+			holder->stats.donations++;
+
+		/* holder가 기다리는 락에 들어있는 holder의 우선순위도 고친다. */
+		lock = holder->want_lock;
+		if (lock == NULL) {
+			if (holder->drain_rw != NULL)
+				rw_donate_readers (holder->drain_rw);
+			return;
+		}
+		if (lock->holder == NULL)
+			return;
+		holder = lock->holder;
+		donation = &lock->donation;
+		top = lock_waiter_max (lock);
 	}
 }
 
-/* priority 재설정하는 함수 */
+/* 현재 스레드의 priority를 origin_priority와 남은 donation으로 재설정.
+   인터럽트가 꺼진 채로 호출. */
 void
 reset_priority(void) {
 	struct thread *curr = thread_current();		// lock holder
 
-	curr->priority = curr->origin_priority;
-	
-	if (!list_empty(&curr->donation_list)) {
-		// list_sort(&curr->donation_list, donate_compare_priority, NULL);
-		struct thread *max_thread = list_entry(list_min(&curr->donation_list, compare_priority, 0), struct thread, d_elem);
-		if (max_thread->priority > curr->priority)
-			curr->priority = max_thread->priority;
+	ASSERT (intr_get_level () == INTR_OFF);
+	// cond_wait() 중이면 condition의 waiters에 들어있으므로 자리를 옮겨야 한다
+	thread_change_priority (curr, donated_priority (curr));
+}
+
+/* T의 (donation이 반영된) 우선순위를 PRIORITY로 바꾼다.
+   T가 ready 상태라면 run queue에서 레벨을 옮겨준다: O(1)
+   semaphore나 condition을 기다리는 중이면 waiters 안의 자리도 옮긴다: O(log n)
+   run queue, waiters의 순서와 priority가 어긋나지 않도록
+   running이 아닌 스레드의 priority는 반드시 이 함수로 바꿔야 한다. */
+void
+thread_change_priority (struct thread *t, int priority) {
+	enum intr_level old_level;
+
+	ASSERT (is_thread (t));
+	ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
+
+	old_level = intr_disable ();
+	if (t->priority != priority) {
+		if (t->status == THREAD_READY)
+			ready_queue_remove (t);
+		if (t->wait_tree != NULL)
+			rb_remove (t->wait_tree, &t->wait_elem);
+		t->priority = priority;
+		if (t->wait_tree != NULL)
+			rb_insert (t->wait_tree, &t->wait_elem);
+		if (t->status == THREAD_READY)
+			ready_queue_push (t);
 	}
+	intr_set_level (old_level);
 }
 
+/* 잠든 스레드 T를 timing wheel에 넣는다.
+   T->end_tick까지 남은 틱 수로 레벨을 고르고, end_tick의 해당 비트들로 슬롯을 고른다. */
+static void
+wheel_insert (struct thread *t) {
+	int64_t expires = t->end_tick;
+	int64_t delta;
+	struct list *slot;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	/* 이미 지난 시간이면 다음에 처리할 tick에 깨운다. */
+	if (expires < wheel_tick)
+		expires = wheel_tick;
+	delta = expires - wheel_tick;
+	if (delta > WHEEL_MAX_TICKS) {
+		/* 너무 먼 미래는 맨 위 레벨의 마지막 칸에 두고 cascade 때 다시 배치한다. */
+		delta = WHEEL_MAX_TICKS;
+		expires = wheel_tick + delta;
+	}
+
+	if (delta < WHEEL_ROOT_SIZE)
+		slot = &wheel_root[expires & (WHEEL_ROOT_SIZE - 1)];
+	else {
+		int level = 0;
+		int shift = WHEEL_ROOT_BITS + WHEEL_LEVEL_BITS;
+		while (level < WHEEL_LEVEL_CNT - 1 && delta >= ((int64_t) 1 << shift)) {
+			level++;
+			shift += WHEEL_LEVEL_BITS;
+		}
+		shift -= WHEEL_LEVEL_BITS;
+		slot = &wheel_level[level][(expires >> shift) & (WHEEL_LEVEL_SIZE - 1)];
+	}
+	list_push_back (slot, &t->elem);
+}
+
+/* LEVEL의 현재 슬롯에 있는 스레드들을 하위 레벨로 다시 배치한다. */
+static void
+wheel_cascade (int level) {
+	int shift = WHEEL_ROOT_BITS + level * WHEEL_LEVEL_BITS;
+	struct list *slot = &wheel_level[level][(wheel_tick >> shift) & (WHEEL_LEVEL_SIZE - 1)];
+	struct list moving;
+
+	/* wheel_insert가 같은 슬롯에 다시 넣을 수도 있으므로 먼저 통째로 떼어낸다. */
+	list_init (&moving);
+	while (!list_empty (slot))
+		list_push_back (&moving, list_pop_front (slot));
+	while (!list_empty (&moving))
+		wheel_insert (list_entry (list_pop_front (&moving), struct thread, elem));
+}
+
+/* NOW_TICKS까지 깨울 시간이 된 스레드들을 모두 깨운다.
+   timer interrupt에서 매 틱 불리며, 처리할 슬롯 하나만 본다. */
 void
 thread_wake(int64_t now_ticks) {
-    while (!list_empty(&sleep_list)) {
-    	struct list_elem *front_elem = list_front(&sleep_list);
-        struct thread *sleep_thread = list_entry(front_elem, struct thread, elem);
-		
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	while (wheel_tick <= now_ticks) {
+		struct list *slot = &wheel_root[wheel_tick & (WHEEL_ROOT_SIZE - 1)];
+
+		/* 레벨 0이 한 바퀴 돌았으면 위 레벨에서 한 칸씩 내려온다. */
+		for (int level = 0; level < WHEEL_LEVEL_CNT; level++) {
+			int shift = WHEEL_ROOT_BITS + level * WHEEL_LEVEL_BITS;
+			if ((wheel_tick & (((int64_t) 1 << shift) - 1)) != 0)
+				break;
+			wheel_cascade (level);
+		}
+
 		// 현재 시각이 일어날 시간을 지났으면 -> 일어나!
-        if (now_ticks >= sleep_thread->end_tick) { 
-			struct thread *wake_thread = list_entry(list_pop_front(&sleep_list), struct thread, elem);
-            thread_unblock(sleep_thread);
-        }
-        else {
-            break;
-        }
-    }
+		while (!list_empty (slot)) {
+			struct thread *t = list_entry (list_pop_front (slot), struct thread, elem);
+			t->sleeping = false;
+			t->timed_out = true;
+			/* 시간 제한이 있는 sema/cond 대기였다면 waiters에서도 뺀다. */
+			if (t->wait_tree != NULL) {
+				rb_remove (t->wait_tree, &t->wait_elem);
+				t->wait_tree = NULL;
+			}
+			thread_unblock (t);
+		}
+		wheel_tick++;
+	}
+}
+
+/* LIMIT 이전에 thread_wake가 처리해야 할 가장 이른 tick을 반환하고, 없으면 LIMIT.
+   위 레벨에서 내려오는 cascade도 제때 처리해야 하므로 레벨 0이 한 바퀴 도는
+   tick도 처리할 tick으로 본다.  LIMIT은 레벨 0 한 바퀴 안쪽이어야 한다. */
+int64_t
+thread_wake_deadline (int64_t limit) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (limit - wheel_tick <= WHEEL_ROOT_SIZE);
+
+	for (int64_t t = wheel_tick; t < limit; t++)
+		if ((t & (WHEEL_ROOT_SIZE - 1)) == 0
+				|| !list_empty (&wheel_root[t & (WHEEL_ROOT_SIZE - 1)]))
+			return t;
+	return limit;
 }
 
 void
@@ -324,12 +661,29 @@ thread_sleep(int64_t wake_time) {
 	ASSERT (!intr_context ());		// 인터럽트를 처리하고 있지 않아야 하고,
 	ASSERT (intr_get_level () == INTR_OFF);		// 인터럽트 상태가 OFF
 
-	struct thread *curr = thread_current();
+	thread_block_until (wake_time);	// block하고 스케줄링
+	intr_set_level(old_level);		// 인터럽트 다시 활성화
+}
+
+/* 현재 스레드를 timing wheel에 넣고 WAKE_TIME까지 block한다.
+   그 전에 다른 스레드가 thread_unblock()으로 깨우면 wheel에서 빠지고 true,
+   WAKE_TIME이 되어 thread_wake()가 깨우면 false.  시간 제한이 있는
+   sema/cond 대기는 waiters에 들어간 채로 부르고, 먼저 온 쪽이 다른 쪽에서
+   스레드를 뺀다.  인터럽트가 꺼진 채로 호출. */
+bool
+thread_block_until (int64_t wake_time) {
+	struct thread *curr = thread_current ();
+
+	ASSERT (!intr_context ());
+	ASSERT (intr_get_level () == INTR_OFF);
+
 	curr->end_tick = wake_time;		// block하는 구조체 깨울 시간 저장
-	list_insert_ordered(&sleep_list, &(curr->elem), compare_ticks, NULL);	// sleep 리스트에 삽입정렬
+	curr->timed_out = false;
+	curr->sleeping = true;
+	wheel_insert (curr);			// timing wheel에 O(1) 삽입
 
-	thread_block ();				// block하고 스케줄링
-	intr_set_level(old_level);		// 인터럽트 다시 활성화
+	thread_block ();
+	return !curr->timed_out;
 }
 
 /* Puts the current thread to sleep.  It will not be scheduled
@@ -360,11 +714,29 @@ thread_unblock (struct thread *t) {
 
 	old_level = intr_disable ();
 	ASSERT (t->status == THREAD_BLOCKED);
-	
-	// ready_list에 넣을 때, list_insert_ordered 사용하기
-	list_insert_ordered(&ready_list, &(t->elem), compare_priority, NULL);
+	ASSERT (t->wait_tree == NULL);
 
+	// 시간 제한이 다 되기 전에 깨어나면 timing wheel에서 뺀다: O(1)
+	if (t->sleeping) {
+		list_remove (&t->elem);
+		t->sleeping = false;
+	}
 
+	// block된 시간이 lock을 기다린 시간이었다면 통계에 반영
+	uint64_t now = rdtsc ();
+	if (t->want_lock != NULL)
+		t->stats.lock_cycles += now - t->stats_stamp;
+	t->stats_stamp = now;
+	// wakeup latency는 여기서부터 schedule()에서 CPU를 받을 때까지
+	t->wake_stamp = now;
+	t->waker = thread_current ()->tid;
+
+	// MLFQS: 자는 동안 감쇠된 recent_cpu와 load_avg를 반영
+	if (thread_mlfqs)
+		t->priority = mlfqs_priority (t);
+	
+	// 자기 우선순위 레벨의 FIFO 맨 뒤에 넣기: O(1)
+	ready_queue_push (t);
 	t->status = THREAD_READY;
 
 	intr_set_level (old_level);
@@ -405,6 +777,7 @@ thread_tid (void) {
 void
 thread_exit (void) {
 	ASSERT (!intr_context ());
+	ASSERT (thread_current ()->rcu_nesting == 0);
 
 #ifdef USERPROG
 	process_exit ();
@@ -430,7 +803,7 @@ thread_yield (void) {
 	old_level = intr_disable ();
 
 	if (curr != idle_thread) {
-		list_insert_ordered(&ready_list, &(curr->elem), compare_priority, NULL);
+		ready_queue_push (curr);
 	}
 
 	do_schedule (THREAD_READY);
@@ -438,13 +811,18 @@ thread_yield (void) {
 }
 
 /* 현재 스레드의 우선순위 = NEW_PRIORITY
-   현재 스레드의 우선순위를 설정하고 ready_list 정렬 */
+   현재 스레드의 우선순위를 설정하고 양보 */
 void
 thread_set_priority (int new_priority) {
 
 	struct thread *curr = thread_current();
+
+	if (thread_mlfqs)		// MLFQS에서는 priority를 스케줄러가 정한다
+		return;
+	enum intr_level old_level = intr_disable ();
 	curr->origin_priority = new_priority;
 	reset_priority();
+	intr_set_level (old_level);
 	thread_yield();
 }
 
@@ -456,29 +834,125 @@ thread_get_priority (void) {
 
 /* Sets the current thread's nice value to NICE. */
 void
-thread_set_nice (int nice UNUSED) {
-	/* TODO: Your implementation goes here */
+thread_set_nice (int nice) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
+	ASSERT (NICE_MIN <= nice && nice <= NICE_MAX);
+
+	old_level = intr_disable ();
+	curr->nice = nice;
+	curr->priority = mlfqs_priority (curr);
+	intr_set_level (old_level);
+
+	// 더 높은 priority의 스레드가 ready라면 양보
+	thread_yield ();
 }
 
 /* Returns the current thread's nice value. */
 int
 thread_get_nice (void) {
-	/* TODO: Your implementation goes here */
-	return 0;
+	return thread_current ()->nice;
 }
 
 /* Returns 100 times the system load average. */
 int
 thread_get_load_avg (void) {
-	/* TODO: Your implementation goes here */
-	return 0;
+	enum intr_level old_level = intr_disable ();
+	int load = fp_round (fp_mul_int (load_avg, 100));
+	intr_set_level (old_level);
+	return load;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int
 thread_get_recent_cpu (void) {
-	/* TODO: Your implementation goes here */
-	return 0;
+	enum intr_level old_level = intr_disable ();
+	int recent = fp_round (fp_mul_int (thread_current ()->recent_cpu, 100));
+	intr_set_level (old_level);
+	return recent;
+}
+
+/* MLFQS: priority = PRI_MAX - (recent_cpu / 4) - (nice * 2), [PRI_MIN, PRI_MAX]로 자름 */
+static int
+mlfqs_priority (struct thread *t) {
+	int priority = fp_to_int (fp_sub_int (fp_sub (fp_from_int (PRI_MAX),
+			fp_div_int (t->recent_cpu, 4)), t->nice * 2));
+
+	if (priority < PRI_MIN)
+		return PRI_MIN;
+	if (priority > PRI_MAX)
+		return PRI_MAX;
+	return priority;
+}
+
+/* 실행 중인 스레드 T의 priority를 다시 계산.
+   ready queue에 더 높은 스레드가 있으면 interrupt가 끝날 때 양보한다. */
+static void
+mlfqs_update_priority (struct thread *t) {
+	if (t == idle_thread)
+		return;
+	t->priority = mlfqs_priority (t);
+	if (runqueue_top (&runqueue) > t->priority)
+		intr_yield_on_return ();
+}
+
+/* ready queue를 한 번 훑으며 모든 ready 스레드의 priority를 다시 계산하고
+   해당 레벨로 옮긴다.  레벨 사이의 순서(FIFO)는 그대로 유지된다. */
+static void
+mlfqs_update_ready_queues (void) {
+	struct runqueue *rq = &runqueue;
+	struct list ready;
+	int pri;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	/* 높은 레벨부터 통째로 떼어내서 한 줄로 세운다: 레벨마다 O(1) */
+	list_init (&ready);
+	while (rq->bitmap != 0) {
+		pri = 63 - __builtin_clzll (rq->bitmap);
+		list_splice (list_end (&ready), list_begin (&rq->queue[pri]),
+				list_end (&rq->queue[pri]));
+		rq->bitmap &= ~(1ULL << pri);
+	}
+
+	while (!list_empty (&ready)) {
+		struct thread *t = list_entry (list_pop_front (&ready), struct thread, elem);
+		/* cond_wait() 안에서 양보한 스레드는 condition의 waiters에도 있다. */
+		if (t->wait_tree != NULL)
+			rb_remove (t->wait_tree, &t->wait_elem);
+		t->priority = mlfqs_priority (t);
+		if (t->wait_tree != NULL)
+			rb_insert (t->wait_tree, &t->wait_elem);
+		list_push_back (&rq->queue[t->priority], &t->elem);
+		rq->bitmap |= 1ULL << t->priority;
+	}
+}
+
+/* 1초마다: load_avg를 갱신하고 모든 스레드의 recent_cpu를 감쇠한 뒤
+   ready queue와 실행 중인 스레드의 priority를 다시 계산한다. */
+static void
+mlfqs_per_second (void) {
+	struct thread *curr = thread_current ();
+	int ready_threads = runqueue.cnt + (curr != idle_thread ? 1 : 0);
+	fixed_t coef;
+	struct list_elem *e;
+
+	// load_avg = (59/60) * load_avg + (1/60) * ready_threads
+	load_avg = fp_add (fp_mul (fp_div_int (fp_from_int (59), 60), load_avg),
+			fp_div_int (fp_from_int (ready_threads), 60));
+
+	// recent_cpu = (2 * load_avg) / (2 * load_avg + 1) * recent_cpu + nice
+	coef = fp_div (fp_mul_int (load_avg, 2), fp_add_int (fp_mul_int (load_avg, 2), 1));
+	for (e = list_begin (&all_list); e != list_end (&all_list); e = list_next (e)) {
+		struct thread *t = list_entry (e, struct thread, all_elem);
+		if (t == idle_thread)
+			continue;
+		t->recent_cpu = fp_add_int (fp_mul (coef, t->recent_cpu), t->nice);
+	}
+
+	mlfqs_update_ready_queues ();
+	mlfqs_update_priority (curr);
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
@@ -502,6 +976,17 @@ idle (void *idle_started_ UNUSED) {
 		intr_disable ();
 		thread_block ();
 
+		/* 멈추기 전에 재활용 페이지와 palloc의 PAL_ZERO 예비 페이지를
+		   한 장씩 0으로 채운다.  채우는 동안만 인터럽트가 켜지고, 채웠으면
+		   그 사이 깨어난 스레드가 있는지 다시 스케줄러에 물어보고 돌아온다.
+		   할 일이 없었으면 인터럽트는 계속 꺼져 있었으니 아래 hlt 전에
+		   깨어난 스레드를 놓치지 않는다. */
+		if (thread_page_zero () || palloc_zero_idle ())
+			continue;
+
+		/* 아무도 실행할 게 없으니 -tickless면 다음 깨울 시간까지 tick을 끈다. */
+		timer_idle_enter ();
+
 		/* Re-enable interrupts and wait for the next one.
 
 		   The `sti' instruction disables interrupts until the
@@ -532,6 +1017,8 @@ kernel_thread (thread_func *function, void *aux) {
    NAME. */
 static void
 init_thread (struct thread *t, const char *name, int priority) {
+	enum intr_level old_level;
+
 	ASSERT (t != NULL);
 	ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
 	ASSERT (name != NULL);
@@ -546,12 +1033,22 @@ init_thread (struct thread *t, const char *name, int priority) {
 	
 	t->status = THREAD_BLOCKED;
 	strlcpy (t->name, name, sizeof t->name);
-	t->tf.rsp = (uint64_t) t + PGSIZE - sizeof (void *);
 	t->priority = priority;
 	t->magic = THREAD_MAGIC;
 	t->origin_priority = priority;
-	list_init(&t->donation_list);	// donation_list init
+	rb_init (&t->donations, donation_less, NULL);
+	list_init (&t->rw_reads);
 	t->want_lock = NULL;			// want_lock init
+	t->wait_tree = NULL;
+	t->sleeping = false;
+	t->rcu_nesting = 0;
+	t->nice = NICE_DEFAULT;
+	t->recent_cpu = 0;
+	t->slice = sched_slice_init ();
+
+	old_level = intr_disable ();
+	list_push_back (&all_list, &t->all_elem);
+	intr_set_level (old_level);
 }
 
 /* Chooses and returns the next thread to be scheduled.  Should
@@ -561,10 +1058,42 @@ init_thread (struct thread *t, const char *name, int priority) {
    idle_thread. */
 static struct thread *
 next_thread_to_run (void) {
-	if (list_empty (&ready_list))
+	struct thread *t = sched_class->pick_next (&runqueue);
+
+	if (t == NULL)
 		return idle_thread;
-	else
-		return list_entry (list_pop_front (&ready_list), struct thread, elem);
+	runqueue.cnt--;
+	return t;
+}
+
+/* RQ에서 비어있지 않은 가장 높은 레벨 = 가장 높은 set bit (bsr 한 번).
+   비어있으면 -1.  priority class (MLFQS 포함)에서만 의미가 있다. */
+static int
+runqueue_top (struct runqueue *rq) {
+	uint64_t bitmap = rq->bitmap;
+	return bitmap != 0 ? 63 - __builtin_clzll (bitmap) : -1;
+}
+
+/* T를 run queue에 넣는다 (priority class면 자기 레벨 FIFO 맨 뒤).
+   인터럽트가 꺼진 상태에서 호출해야 한다. */
+static void
+ready_queue_push (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+	sched_class->enqueue (&runqueue, t);
+	runqueue.cnt++;
+}
+
+/* ready 상태인 T를 run queue에서 뺀다.
+   T는 마지막으로 넣었을 때의 priority로 들어있어야 한다. */
+static void
+ready_queue_remove (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (t->status == THREAD_READY);
+
+	sched_class->dequeue (&runqueue, t);
+	runqueue.cnt--;
 }
 
 /* Use iretq to launch the thread */
@@ -607,61 +1136,126 @@ do_iret (struct intr_frame *tf) {
    added at the end of the function. */
 static void
 thread_launch (struct thread *th) {
-	uint64_t tf_cur = (uint64_t) &running_thread ()->tf;
-	uint64_t tf = (uint64_t) &th->tf;
 	ASSERT (intr_get_level () == INTR_OFF);
 
-	/* The main switching logic.
-	 * We first restore the whole execution context into the intr_frame
-	 * and then switching to the next thread by calling do_iret.
-	 * Note that, we SHOULD NOT use any stack from here
-	 * until switching is done. */
-	__asm __volatile (
-			/* Store registers that will be used. */
-			"push %%rax\n"
-			"push %%rbx\n"
-			"push %%rcx\n"
-			/* Fetch input once */
-			"movq %0, %%rax\n"
-			"movq %1, %%rcx\n"
-			"movq %%r15, 0(%%rax)\n"
-			"movq %%r14, 8(%%rax)\n"
-			"movq %%r13, 16(%%rax)\n"
-			"movq %%r12, 24(%%rax)\n"
-			"movq %%r11, 32(%%rax)\n"
-			"movq %%r10, 40(%%rax)\n"
-			"movq %%r9, 48(%%rax)\n"
-			"movq %%r8, 56(%%rax)\n"
-			"movq %%rsi, 64(%%rax)\n"
-			"movq %%rdi, 72(%%rax)\n"
-			"movq %%rbp, 80(%%rax)\n"
-			"movq %%rdx, 88(%%rax)\n"
-			"pop %%rbx\n"              // Saved rcx
-			"movq %%rbx, 96(%%rax)\n"
-			"pop %%rbx\n"              // Saved rbx
-			"movq %%rbx, 104(%%rax)\n"
-			"pop %%rbx\n"              // Saved rax
-			"movq %%rbx, 112(%%rax)\n"
-			"addq $120, %%rax\n"
-			"movw %%es, (%%rax)\n"
-			"movw %%ds, 8(%%rax)\n"
-			"addq $32, %%rax\n"
-			"call __next\n"         // read the current rip.
-			"__next:\n"
-			"pop %%rbx\n"
-			"addq $(out_iret -  __next), %%rbx\n"
-			"movq %%rbx, 0(%%rax)\n" // rip
-			"movw %%cs, 8(%%rax)\n"  // cs
-			"pushfq\n"
-			"popq %%rbx\n"
-			"mov %%rbx, 16(%%rax)\n" // eflags
-			"mov %%rsp, 24(%%rax)\n" // rsp
-			"movw %%ss, 32(%%rax)\n"
-			"mov %%rcx, %%rdi\n"
-			"call do_iret\n"
-			"out_iret:\n"
-			: : "g"(tf_cur), "g" (tf) : "memory"
-			);
+	/* 커널 스레드끼리의 전환이므로 callee-saved 레지스터와 rsp, rip만
+	 * 바꾸면 된다.  전체 intr_frame과 iretq는 유저 모드로 들어갈 때만
+	 * do_iret()에서 쓴다.  나중에 이 스레드가 다시 선택되면
+	 * switch_threads()에서 돌아와 schedule()로 복귀한다. */
+	switch_threads (&running_thread ()->rsp, th->rsp);
+}
+
+/* 스레드 페이지를 하나 받는다.  clean, dirty 캐시 순으로 보고 없으면 palloc.
+   어느 쪽이든 struct thread 부분은 init_thread()가 지운다. */
+static struct thread *
+thread_page_get (void) {
+	struct list_elem *e = NULL;
+	enum intr_level old_level = intr_disable ();
+
+	if (!list_empty (&cache_clean))
+		e = list_pop_front (&cache_clean);
+	else if (!list_empty (&cache_dirty))
+		e = list_pop_front (&cache_dirty);
+	if (e != NULL) {
+		cache_cnt--;
+		cache_hits++;
+	} else
+		cache_misses++;
+	intr_set_level (old_level);
+
+	if (e == NULL)
+		return palloc_get_page (0);
+	return (struct thread *) list_entry (e, struct cached_page, elem);
+}
+
+/* 종료한 스레드 T의 페이지를 캐시에 넣고, 캐시가 차 있으면 palloc에 돌려준다.
+   T를 is_thread()로 착각하지 않도록 magic을 지운다. */
+static void
+thread_page_put (struct thread *t) {
+	struct cached_page *cp = (struct cached_page *) t;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (cache_cnt >= THREAD_CACHE_MAX) {
+		palloc_free_page (t);
+		return;
+	}
+	t->magic = 0;
+	list_push_front (&cache_dirty, &cp->elem);
+	cache_cnt++;
+}
+
+/* idle 스레드에서 인터럽트가 꺼진 채로 호출.  -zero-threads면 dirty 페이지
+   하나를 0으로 채워 clean으로 옮기고 true, 할 일이 없으면 false.
+   리스트에서 꺼내고 넣을 때만 인터럽트를 끄고, 4 kB memset 동안은 켜 둬서
+   그 사이 깨어난 스레드가 바로 선점할 수 있다.  꺼낸 페이지는 어느 리스트에도
+   없으니 그동안 다른 스레드가 건드리지 않는다.  돌아올 때는 다시 꺼져 있다.
+   리스트 원소 자리는 꺼낼 때 init_thread()가 다시 지운다. */
+static bool
+thread_page_zero (void) {
+	struct cached_page *cp;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (!thread_zero_pages || list_empty (&cache_dirty))
+		return false;
+	cp = list_entry (list_pop_front (&cache_dirty), struct cached_page, elem);
+	intr_enable ();
+	memset (cp, 0, PGSIZE);
+	intr_disable ();
+	list_push_back (&cache_clean, &cp->elem);
+	cache_zeroed++;
+	return true;
+}
+
+/* unblock된 T가 PREV 다음으로 CPU를 받기까지 CYCLES가 걸렸다. */
+static void
+latency_record (struct thread *t, struct thread *prev, uint64_t cycles) {
+	int bucket = cycles != 0 ? 63 - __builtin_clzll (cycles) : 0;
+
+	latency_hist[t->priority][bucket]++;
+	latency_sum[t->priority] += cycles;
+	if (cycles > latency_max[t->priority])
+		latency_max[t->priority] = cycles;
+
+	if (cycles > latency_worst.cycles) {
+		latency_worst.cycles = cycles;
+		latency_worst.tid = t->tid;
+		strlcpy (latency_worst.name, t->name, sizeof latency_worst.name);
+		latency_worst.priority = t->priority;
+		latency_worst.waker = t->waker;
+		latency_worst.prev_tid = prev->tid;
+		strlcpy (latency_worst.prev_name, prev->name, sizeof latency_worst.prev_name);
+		latency_worst.prev_priority = prev->priority;
+	}
+}
+
+/* Prints wakeup latency histograms: 우선순위마다 한 줄의 요약과
+   비어있지 않은 log2 bucket들. */
+void
+thread_print_latency (void) {
+	for (int pri = PRI_MIN; pri <= PRI_MAX; pri++) {
+		unsigned cnt = 0;
+		for (int i = 0; i < LATENCY_BUCKETS; i++)
+			cnt += latency_hist[pri][i];
+		if (cnt == 0)
+			continue;
+
+		printf ("Latency: priority %d: %u wakeups, avg %llu cycles, max %llu cycles\n",
+				pri, cnt, latency_sum[pri] / cnt, latency_max[pri]);
+		printf ("Latency: ");
+		for (int i = 0; i < LATENCY_BUCKETS; i++)
+			if (latency_hist[pri][i] != 0)
+				printf (" 2^%d:%u", i, latency_hist[pri][i]);
+		printf ("\n");
+	}
+	if (latency_worst.cycles != 0)
+		printf ("Latency: worst %llu cycles: thread %d \"%s\" (priority %d), "
+				"woken by thread %d, after thread %d \"%s\" (priority %d)\n",
+				latency_worst.cycles, latency_worst.tid, latency_worst.name,
+				latency_worst.priority, latency_worst.waker,
+				latency_worst.prev_tid, latency_worst.prev_name,
+				latency_worst.prev_priority);
 }
 
 /* Schedules a new process. At entry, interrupts must be off.
@@ -675,7 +1269,9 @@ do_schedule(int status) {		// 새로운 프로세스를 스케줄 하는 과정,
 	while (!list_empty (&destruction_req)) {
 		struct thread *victim =
 			list_entry (list_pop_front (&destruction_req), struct thread, elem);
-		palloc_free_page(victim);
+		if (victim->fpu_area != NULL)
+			palloc_free_page (victim->fpu_area);
+		thread_page_put (victim);
 	}
 	thread_current ()->status = status;
 	schedule ();
@@ -684,16 +1280,46 @@ do_schedule(int status) {		// 새로운 프로세스를 스케줄 하는 과정,
 static void
 schedule (void) {
 	struct thread *curr = running_thread ();		// 현재 실행중인 스레드인 주소
-	struct thread *next = next_thread_to_run ();	// 다음에 실행될 스레드인 주소
+	struct thread *next;
 
 	ASSERT (intr_get_level () == INTR_OFF);		// 인터럽트 X
 	ASSERT (curr->status != THREAD_RUNNING);	// 러닝상태가 아니어야하고
+
+	/* 문맥 교환마다 RCU grace period가 끝났는지 본다: O(1) */
+	rcu_quiescent ();
+	/* idle에서 벗어나면 끊어둔 tick을 보정하고 주기적인 tick을 재개.
+	   보정하면서 깨어난 스레드도 고를 수 있도록 next보다 먼저 한다. */
+	if (curr == idle_thread)
+		timer_idle_exit ();
+	/* CURR가 이번 slice를 어떻게 썼는지에 따라 다음 slice 길이를 조절 */
+	if (curr != idle_thread)
+		sched_slice_adapt (curr, thread_ticks, curr->status == THREAD_BLOCKED);
+	next = next_thread_to_run ();				// 다음에 실행될 스레드인 주소
+
 	ASSERT (is_thread (next));					// next가 유효한 thread인지
+
+	/* 통계: CURR이 실행한 시간, NEXT가 ready queue에서 기다린 시간 */
+	uint64_t now = rdtsc ();
+	curr->stats.run_cycles += now - curr->stats_stamp;
+	curr->stats_stamp = now;
+	if (next != curr && next != idle_thread)
+		next->stats.ready_cycles += now - next->stats_stamp;
+	next->stats_stamp = now;
+	if (next->wake_stamp != 0) {
+		if (next != idle_thread)
+			latency_record (next, curr, now - next->wake_stamp);
+		next->wake_stamp = 0;
+	}
+
 	/* Mark us as running. */
 	next->status = THREAD_RUNNING;				// next를 running상태로 만들어줌
 
 	/* Start new time slice. */
 	thread_ticks = 0;							// 마지막으로 실행된 스레드가 사용한 시간 = 0으로 초기화
+	if (next != idle_thread) {
+		next->stats.slices++;
+		next->stats.slice_ticks += next->slice;
+	}
 
 #ifdef USERPROG
 	/* Activate the new address space. */
@@ -701,16 +1327,34 @@ schedule (void) {
 #endif
 
 	if (curr != next) {
+		/* 아직 실행할 수 있는데 CPU를 뺏겼으면 비자발적, block/종료면 자발적 */
+		if (curr->status == THREAD_READY)
+			curr->stats.involuntary_switches++;
+		else
+			curr->stats.voluntary_switches++;
+
 		/* 만약 우리가 스위칭한 스레드가 종료 중인 경우, 해당 스레드의 struct thread를 파괴한다.
 		   이것은 thread_exit()가 자신의 발을 잡아당기지 않도록 늦게 발생해야 한다. 
 		   여기에서는 페이지 해제 요청을 대기열에 추가하는 것만 수행한다.
 		   왜냐하면 현재 페이지는 스택에서 사용 중이기 때문이다.
 		   실제 파괴 로직은 schedule()의 시작 부분에서 호출될 것이다. */
-		if (curr && curr->status == THREAD_DYING && curr != initial_thread) {
-			ASSERT (curr != next);
-			list_push_back (&destruction_req, &curr->elem);
+		if (curr && curr->status == THREAD_DYING) {
+			struct exited_stats *x = &exited_stats[exited_cnt++ % EXITED_STATS_CNT];
+			x->tid = curr->tid;
+			strlcpy (x->name, curr->name, sizeof x->name);
+			x->priority = curr->priority;
+			x->stats = curr->stats;
+			list_remove (&curr->all_elem);
+			fpu_exit (curr);
+			if (curr != initial_thread) {
+				ASSERT (curr != next);
+				list_push_back (&destruction_req, &curr->elem);
+			}
 		}
 
+		/* FPU 레지스터는 lazy하게 바꾼다: 주인이 아니면 TS만 켠다. */
+		fpu_switch (next);
+
 		/* Before switching the thread, we first save the information
 		 * of current running. */
 		thread_launch (next);
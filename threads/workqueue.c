@@ -0,0 +1,271 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Workqueue.  workqueue.h의 설명 참고.
+
+   queue, 카운터들은 인터럽트 핸들러도 건드리므로 lock 대신 인터럽트를
+   꺼서 보호한다.  ready 세마포어의 값은 항상 queue의 길이와 같다. */
+
+/* 모든 workqueue의 delayed work, due 순으로 정렬.  timer interrupt에서
+   wq_tick()이 때가 된 것을 해당 workqueue의 queue로 옮긴다. */
+static struct list delayed_list;
+
+static thread_func worker;
+static bool worker_spawn (struct workqueue *);
+static void queue_work (struct workqueue *, struct work *);
+static bool wq_drained (struct workqueue *);
+
+/* Initializes the workqueue subsystem. */
+void
+wq_init (void) {
+	list_init (&delayed_list);
+}
+
+/* WORK를 아무 데도 들어있지 않은 상태로 초기화 */
+void
+work_init (struct work *work) {
+	ASSERT (work != NULL);
+
+	work->func = NULL;
+	work->aux = NULL;
+	work->pending = false;
+	work->wq = NULL;
+}
+
+/* NAME이라는 이름으로 PRIORITY인 worker를 최대 MAX_WORKERS개까지 쓰는
+   workqueue를 만든다.  worker 하나는 바로 만들어둔다.
+   메모리가 없으면 NULL. */
+struct workqueue *
+wq_create (const char *name, int priority, int max_workers) {
+	struct workqueue *wq;
+
+	ASSERT (!intr_context ());
+	ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
+	ASSERT (max_workers > 0);
+
+	wq = malloc (sizeof *wq);
+	if (wq == NULL)
+		return NULL;
+	strlcpy (wq->name, name, sizeof wq->name);
+	wq->priority = priority;
+	wq->max_workers = max_workers;
+	wq->worker_cnt = 1;
+	wq->idle_cnt = 0;
+	wq->running = 0;
+	wq->delayed_cnt = 0;
+	wq->flush_waiters = 0;
+	list_init (&wq->queue);
+	sema_init (&wq->ready, 0);
+	sema_init (&wq->flushed, 0);
+	wq->done_cnt = 0;
+
+	if (!worker_spawn (wq)) {
+		free (wq);
+		return NULL;
+	}
+	return wq;
+}
+
+/* WORK가 FUNC (AUX)를 실행하도록 WQ에 넣는다.  WORK가 이미 들어있으면
+   아무것도 하지 않고 false.  인터럽트 핸들러에서도 부를 수 있다. */
+bool
+wq_queue (struct workqueue *wq, struct work *work, work_func *func, void *aux) {
+	enum intr_level old_level;
+	bool spawn;
+
+	ASSERT (wq != NULL);
+	ASSERT (work != NULL);
+	ASSERT (func != NULL);
+
+	old_level = intr_disable ();
+	if (work->pending) {
+		intr_set_level (old_level);
+		return false;
+	}
+	work->func = func;
+	work->aux = aux;
+	work->wq = wq;
+	work->pending = true;
+	queue_work (wq, work);
+
+	/* 쉬는 worker가 없으면 하나 더 만든다.  인터럽트에서는 못 만든다. */
+	spawn = !intr_context () && wq->idle_cnt == 0
+		&& wq->worker_cnt < wq->max_workers;
+	if (spawn)
+		wq->worker_cnt++;
+	intr_set_level (old_level);
+
+	if (spawn)
+		worker_spawn (wq);
+	return true;
+}
+
+/* wq_queue()와 같지만 TICKS timer tick 뒤에 실행한다.
+   인터럽트 핸들러에서도 부를 수 있다. */
+bool
+wq_queue_delayed (struct workqueue *wq, struct work *work, work_func *func,
+		void *aux, int64_t ticks) {
+	enum intr_level old_level;
+	struct list_elem *e;
+
+	if (ticks <= 0)
+		return wq_queue (wq, work, func, aux);
+
+	ASSERT (wq != NULL);
+	ASSERT (work != NULL);
+	ASSERT (func != NULL);
+
+	old_level = intr_disable ();
+	if (work->pending) {
+		intr_set_level (old_level);
+		return false;
+	}
+	work->func = func;
+	work->aux = aux;
+	work->wq = wq;
+	work->pending = true;
+	work->due = timer_ticks () + ticks;
+
+	/* due 순서, 같으면 먼저 넣은 것이 앞 */
+	for (e = list_begin (&delayed_list); e != list_end (&delayed_list);
+			e = list_next (e))
+		if (list_entry (e, struct work, elem)->due > work->due)
+			break;
+	list_insert (e, &work->elem);
+	wq->delayed_cnt++;
+	intr_set_level (old_level);
+	return true;
+}
+
+/* WQ가 완전히 빌 때까지 기다린다: queue, 아직 때가 안 된 delayed work,
+   실행 중인 work가 모두 없을 때.  work 함수 안에서 부르면 안 된다. */
+void
+wq_flush (struct workqueue *wq) {
+	enum intr_level old_level;
+
+	ASSERT (!intr_context ());
+
+	old_level = intr_disable ();
+	while (!wq_drained (wq)) {
+		wq->flush_waiters++;
+		sema_down (&wq->flushed);
+	}
+	intr_set_level (old_level);
+}
+
+/* Timer interrupt: 때가 된 delayed work를 각자의 queue로 옮긴다. */
+void
+wq_tick (int64_t now) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	while (!list_empty (&delayed_list)) {
+		struct work *work = list_entry (list_front (&delayed_list),
+				struct work, elem);
+		if (work->due > now)
+			break;
+		list_pop_front (&delayed_list);
+		work->wq->delayed_cnt--;
+		queue_work (work->wq, work);
+	}
+}
+
+/* -tickless: LIMIT과 가장 이른 delayed work 중 빠른 tick */
+int64_t
+wq_deadline (int64_t limit) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (!list_empty (&delayed_list)) {
+		int64_t due = list_entry (list_front (&delayed_list),
+				struct work, elem)->due;
+		if (due < limit)
+			return due;
+	}
+	return limit;
+}
+
+/* WORK를 WQ의 queue 맨 뒤에 넣고 worker 하나를 깨운다. */
+static void
+queue_work (struct workqueue *wq, struct work *work) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	list_push_back (&wq->queue, &work->elem);
+	sema_up (&wq->ready);
+}
+
+/* 남은 일이 전혀 없으면 true */
+static bool
+wq_drained (struct workqueue *wq) {
+	return list_empty (&wq->queue) && wq->delayed_cnt == 0 && wq->running == 0;
+}
+
+/* WQ의 worker 스레드를 하나 만든다.  worker_cnt는 호출자가 미리 올려둔다. */
+static bool
+worker_spawn (struct workqueue *wq) {
+	if (thread_create (wq->name, wq->priority, worker, wq) != TID_ERROR)
+		return true;
+
+	enum intr_level old_level = intr_disable ();
+	wq->worker_cnt--;
+	intr_set_level (old_level);
+	return false;
+}
+
+/* Worker 스레드: queue에서 work를 꺼내 실행한다.  일이 밀려 있고 쉬는
+   worker가 없으면 하나 더 만들고, queue가 비면 마지막 하나만 남기고 끝난다. */
+static void
+worker (void *wq_) {
+	struct workqueue *wq = wq_;
+
+	for (;;) {
+		enum intr_level old_level;
+		struct work *work;
+		work_func *func;
+		void *aux;
+		bool spawn, quit;
+
+		old_level = intr_disable ();
+		wq->idle_cnt++;
+		sema_down (&wq->ready);
+		wq->idle_cnt--;
+
+		work = list_entry (list_pop_front (&wq->queue), struct work, elem);
+		func = work->func;
+		aux = work->aux;
+		work->pending = false;		/* 이제부터 다시 넣을 수 있다 */
+		wq->running++;
+
+		spawn = !list_empty (&wq->queue) && wq->idle_cnt == 0
+			&& wq->worker_cnt < wq->max_workers;
+		if (spawn)
+			wq->worker_cnt++;
+		intr_set_level (old_level);
+
+		if (spawn)
+			worker_spawn (wq);
+
+		/* WORK는 FUNC가 해제할 수도 있으니 이후로 건드리지 않는다. */
+		func (aux);
+
+		old_level = intr_disable ();
+		wq->running--;
+		wq->done_cnt++;
+		if (wq_drained (wq))
+			while (wq->flush_waiters > 0) {
+				wq->flush_waiters--;
+				sema_up (&wq->flushed);
+			}
+		quit = list_empty (&wq->queue) && wq->worker_cnt > 1;
+		if (quit)
+			wq->worker_cnt--;
+		intr_set_level (old_level);
+
+		if (quit)
+			return;
+	}
+}
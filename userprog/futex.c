@@ -0,0 +1,166 @@
+#include "userprog/futex.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include "threads/mmu.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Futex.  futex.h의 설명 참고.
+
+   대기 큐는 key (frame의 커널 가상 주소 + offset)를 hash한 bucket에
+   들어있다.  기다리는 스레드는 자기 스택에 futex_waiter를 두고 그
+   semaphore에서 잠든다.  인터럽트를 끈 채로 값을 확인하고 큐에
+   넣으므로, 그 사이에 값을 바꾼 스레드의 futex_wake()를 놓치지
+   않는다: wake가 sema_down()보다 먼저 오면 semaphore 값이 1이 된다. */
+
+#define FUTEX_BUCKETS 64                /* 2의 거듭제곱 */
+
+/* futex_wait()에서 기다리는 스레드 하나 */
+struct futex_waiter {
+	uintptr_t key;
+	struct thread *thread;
+	struct semaphore sema;
+	struct list_elem elem;
+};
+
+static struct futex_bucket {
+	struct list waiters;            /* 들어온 순서 */
+} buckets[FUTEX_BUCKETS];
+
+static struct futex_bucket *bucket_of (uintptr_t key);
+static bool futex_key (int *uaddr, uintptr_t *key);
+
+/* Initializes the futex hash table. */
+void
+futex_init (void) {
+	for (int i = 0; i < FUTEX_BUCKETS; i++) {
+		list_init (&buckets[i].waiters);
+	}
+}
+
+/* *UADDR가 아직 EXPECTED이면 futex_wake()로 깨울 때까지 잠든다.
+   깨어나면 0, 값이 이미 달랐거나 UADDR가 잘못됐으면 -1.
+   깨어난 뒤 값은 다시 확인해야 한다. */
+int
+futex_wait (int *uaddr, int expected) {
+	struct futex_waiter w;
+	struct futex_bucket *b;
+	enum intr_level old_level;
+
+	if (!futex_key (uaddr, &w.key))
+		return -1;
+	w.thread = thread_current ();
+	sema_init (&w.sema, 0);
+
+	b = bucket_of (w.key);
+	old_level = intr_disable ();
+	if (*(volatile int *) w.key != expected) {
+		intr_set_level (old_level);
+		return -1;
+	}
+	list_push_back (&b->waiters, &w.elem);
+	intr_set_level (old_level);
+
+	sema_down (&w.sema);
+	return 0;
+}
+
+/* futex_wait()에서 잠든 스레드 중 killed가 표시된 스레드를 값과 상관없이
+   모두 깨운다.  프로세스가 끝날 때 남은 스레드들을 나가게 하는 데 쓴다. */
+void
+futex_wake_killed (void) {
+	enum intr_level old_level;
+	struct list woken;
+
+	list_init (&woken);
+	old_level = intr_disable ();
+	for (int i = 0; i < FUTEX_BUCKETS; i++) {
+		struct list *waiters = &buckets[i].waiters;
+		struct list_elem *e = list_begin (waiters);
+
+		while (e != list_end (waiters)) {
+			struct futex_waiter *w = list_entry (e, struct futex_waiter, elem);
+			e = list_next (e);
+			if (w->thread->killed) {
+				list_remove (&w->elem);
+				list_push_back (&woken, &w->elem);
+			}
+		}
+	}
+	intr_set_level (old_level);
+
+	/* futex_wake()처럼 sema_up() 전에 꺼낸다. */
+	while (!list_empty (&woken)) {
+		struct futex_waiter *w = list_entry (list_pop_front (&woken),
+				struct futex_waiter, elem);
+		sema_up (&w->sema);
+	}
+}
+
+/* UADDR에서 기다리는 스레드를 CNT개까지 깨운다.  semaphore처럼 우선순위가
+   높은 스레드부터, 같으면 먼저 온 스레드부터 깨운다.  깨운 수를 반환. */
+int
+futex_wake (int *uaddr, int cnt) {
+	struct futex_bucket *b;
+	enum intr_level old_level;
+	struct list woken;
+	uintptr_t key;
+	int n = 0;
+
+	if (!futex_key (uaddr, &key))
+		return -1;
+
+	b = bucket_of (key);
+	list_init (&woken);
+	old_level = intr_disable ();
+	while (n < cnt) {
+		struct futex_waiter *best = NULL;
+		struct list_elem *e;
+
+		for (e = list_begin (&b->waiters); e != list_end (&b->waiters);
+				e = list_next (e)) {
+			struct futex_waiter *w = list_entry (e, struct futex_waiter, elem);
+			if (w->key == key
+					&& (best == NULL || w->thread->priority > best->thread->priority))
+				best = w;
+		}
+		if (best == NULL)
+			break;
+		list_remove (&best->elem);
+		list_push_back (&woken, &best->elem);
+		n++;
+	}
+	intr_set_level (old_level);
+
+	/* sema_up()은 양보할 수 있으므로 인터럽트를 켠 뒤에.  깨어난 스레드는 곧
+	   자기 스택의 futex_waiter를 버리므로 sema_up() 전에 꺼낸다. */
+	while (!list_empty (&woken)) {
+		struct futex_waiter *w = list_entry (list_pop_front (&woken),
+				struct futex_waiter, elem);
+		sema_up (&w->sema);
+	}
+	return n;
+}
+
+static struct futex_bucket *
+bucket_of (uintptr_t key) {
+	return &buckets[hash_int ((int) (key >> 2)) & (FUTEX_BUCKETS - 1)];
+}
+
+/* 현재 프로세스의 UADDR를 key로 바꾼다.  UADDR가 4 byte로 정렬되지
+   않았거나 매핑되어 있지 않으면 false. */
+static bool
+futex_key (int *uaddr, uintptr_t *key) {
+	void *kva;
+
+	if (!is_user_vaddr (uaddr) || (uintptr_t) uaddr % sizeof (int) != 0)
+		return false;
+	kva = pml4_get_page (thread_current ()->pml4, uaddr);
+	if (kva == NULL)
+		return false;
+	*key = (uintptr_t) kva;
+	return true;
+}
@@ -5,15 +5,19 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "userprog/futex.h"
 #include "userprog/gdt.h"
 #include "userprog/tss.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "threads/flags.h"
+#include "threads/fpu.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "threads/vaddr.h"
@@ -27,15 +31,63 @@ static void process_cleanup (void);
 static bool load (const char *file_name, struct intr_frame *if_);
 static void initd (void *f_name);
 static void __do_fork (void *);
+static void start_uthread (void *);
+static void group_leave (struct thread *);
 struct child_info* get_child_with_pid(tid_t child_tid, struct list *child_list);
 
 static struct semaphore *fork_sema;
 static struct semaphore *wait_sema;
 
-/* General process initializer for initd and other process. */
-static void
+/* 부모의 child_list에 거는 struct child_info용 cache */
+static struct kmem_cache *child_cache;
+
+/* process.c가 쓰는 slab cache를 만든다.  첫 프로세스를 만들기 전에 부른다. */
+void
+process_cache_init (void) {
+    child_cache = kmem_cache_create ("child_info", sizeof (struct child_info),
+            NULL);
+    if (child_cache == NULL)
+        PANIC ("process_cache_init: out of memory");
+}
+
+/* General process initializer for initd and other process.
+ * 순수 커널 스레드는 fd table도 child_info도 쓰지 않으므로 thread_create()가 아니라
+ * 유저 프로세스가 되는 이 시점에 만든다.  메모리가 없으면 false. */
+static bool
 process_init (void) {
     struct thread *curr = thread_current ();
+    struct child_info *info;
+
+    curr->fd_table = palloc_get_page (PAL_ZERO);
+    if (curr->fd_table == NULL)
+        return false;
+
+    /* 이 스레드가 leader인 스레드 묶음 */
+    curr->group = malloc (sizeof *curr->group);
+    if (curr->group == NULL)
+        return false;
+    curr->group->refcnt = 1;
+    curr->group->fd_cnt = 2;                    // 표준 입출력 0,1 제외
+    list_init (&curr->group->members);
+    list_push_back (&curr->group->members, &curr->group_elem);
+    list_init (&curr->group->threads);
+    sema_init (&curr->group->leave, 0);
+    curr->group->exiting = false;
+    curr->group->exit_status = 0;
+
+    /* 부모의 자식 목록에 내 정보를 등록 (process_wait, 종료 상태 전달용) */
+    info = kmem_cache_alloc (child_cache);
+    if (info == NULL) {
+        free (curr->group);
+        curr->group = NULL;
+        return false;
+    }
+    info->tid = curr->tid;
+    info->exit_status = 0;
+    info->child_t = curr;
+    info->exited = false;
+    list_push_back (&curr->parent->child_list, &info->c_elem);
+    return true;
 }
 
 /* "initd"라는 이름의 첫 번째 사용자 랜드 프로그램을 FILE_NAME에서 로드하고 시작합니다.
@@ -69,6 +121,8 @@ process_create_initd (const char *file_name) {
 	tid = thread_create (token, PRI_DEFAULT, initd, fn_copy);
 	if (tid == TID_ERROR)
 		palloc_free_page (fn_copy);
+	else
+		sema_down (&thread_current ()->fork_sema);	// initd가 process_init()을 마칠 때까지
 	return tid;
 }
 
@@ -79,7 +133,9 @@ initd (void *f_name) {
     supplemental_page_table_init (&thread_current ()->spt);
 #endif
 
-    process_init ();
+    if (!process_init ())
+        PANIC("Fail to launch initd\n");
+    sema_up (&thread_current ()->parent->fork_sema);
 
     if (process_exec (f_name) < 0)
         PANIC("Fail to launch initd\n");
@@ -170,12 +226,20 @@ __do_fork (void *aux) {
 	/* 1. CPU 컨텍스트를 로컬 스택으로 읽어옵니다. */
 	memcpy (&tmp_if, &parent->parent_if, sizeof (struct intr_frame));
 
+	/* 실패해도 부모가 wait로 종료 상태를 받을 수 있도록 제일 먼저 등록 */
+	if (!process_init ())
+		goto error;
+
 	/* 2. 페이지 테이블(PT)을 복제합니다. */
 	child->pml4 = pml4_create();
 	if (child->pml4 == NULL)
 		goto error;
 	
     process_activate (child);
+
+	/* FPU 상태도 부모에게서 복제 */
+	if (!fpu_fork (child, parent))
+		goto error;
 #ifdef VM
 	supplemental_page_table_init (&child->spt);
 	if (!supplemental_page_table_copy (&child->spt, &parent->spt))
@@ -190,15 +254,13 @@ __do_fork (void *aux) {
 		include/filesys/file.h에 있는 'file_duplicate' 함수를 사용하세요.
 		부모가 리소스를 성공적으로 복제하기 전까지 fork()에서 돌아오지 않아야 합니다
 	*/
-	process_init ();
-
 	for(int i=2; i < FDT_COUNT_LIMIT; i++) {
         struct file *file = parent->fd_table[i];
         if (!file)
             continue;
 		child->fd_table[i] = file_duplicate (file);
 	}
-	child->fd_cnt = parent->fd_cnt;
+	child->group->fd_cnt = parent->group->fd_cnt;
 	tmp_if.R.rax = 0;
 
 	sema_up(&parent->fork_sema);
@@ -214,6 +276,177 @@ error:
 }
 
 
+/* clone()에서 새 스레드에게 넘기는 정보.  만든 스레드의 스택에 있다. */
+struct clone_args {
+	struct intr_frame if_;          /* 새 스레드가 유저 모드로 돌아갈 때의 레지스터 */
+	struct thread *creator;
+	struct uthread_info *info;
+	struct semaphore started;       /* 새 스레드가 IF_를 복사하면 up */
+};
+
+/* 현재 프로세스 안에 ENTRY (ARG)를 STACK에서 실행하는 스레드를 만든다.
+ * 새 스레드는 pml4와 fd table을 현재 스레드와 공유하고 IF_의 나머지
+ * 레지스터를 물려받는다.  새 스레드의 tid, 만들 수 없으면 TID_ERROR. */
+tid_t
+process_clone (void *entry, void *arg, void *stack, struct intr_frame *if_) {
+	struct thread *curr = thread_current ();
+	struct clone_args args;
+	struct uthread_info *info;
+	enum intr_level old_level;
+	tid_t tid;
+
+	if (curr->group == NULL)
+		return TID_ERROR;
+
+	info = malloc (sizeof *info);
+	if (info == NULL)
+		return TID_ERROR;
+	info->tid = TID_ERROR;
+	info->exit_status = 0;
+	info->alone = false;
+	sema_init (&info->done, 0);
+
+	/* ENTRY가 call로 불린 것처럼: rsp + 8이 16 byte 정렬, return address는 0 */
+	memcpy (&args.if_, if_, sizeof args.if_);
+	args.if_.rip = (uint64_t) entry;
+	args.if_.R.rdi = (uint64_t) arg;
+	args.if_.rsp = ((uint64_t) stack & ~0xfULL) - sizeof (uint64_t);
+	args.creator = curr;
+	args.info = info;
+	sema_init (&args.started, 0);
+
+	/* 새 스레드가 pml4를 쓰기 전에 refcnt를 올려둔다. */
+	old_level = intr_disable ();
+	curr->group->refcnt++;
+	list_push_back (&curr->group->threads, &info->elem);
+	intr_set_level (old_level);
+
+	/* 만든 스레드의 (donation을 뺀) 우선순위를 물려받는다. */
+	tid = thread_create (curr->name, curr->origin_priority, start_uthread, &args);
+	if (tid == TID_ERROR) {
+		old_level = intr_disable ();
+		curr->group->refcnt--;
+		list_remove (&info->elem);
+		intr_set_level (old_level);
+		free (info);
+		return TID_ERROR;
+	}
+	/* clone()이 돌아가기 전에는 아무도 TID를 모르므로 join과 겹치지 않는다. */
+	info->tid = tid;
+	sema_down (&args.started);
+	return tid;
+}
+
+/* clone()으로 만든 스레드: 만든 스레드의 주소 공간으로 들어가 유저 모드로 */
+static void
+start_uthread (void *args_) {
+	struct clone_args *args = args_;
+	struct thread *curr = thread_current ();
+	struct thread *creator = args->creator;
+	struct intr_frame if_;
+	enum intr_level old_level;
+
+	memcpy (&if_, &args->if_, sizeof if_);
+	curr->group = creator->group;
+	curr->uthread = args->info;
+	curr->pml4 = creator->pml4;
+	curr->fd_table = creator->fd_table;
+	curr->parent = NULL;            /* 프로세스의 부모-자식 관계에는 끼지 않는다 */
+	process_activate (curr);
+
+	old_level = intr_disable ();
+	list_push_back (&curr->group->members, &curr->group_elem);
+	curr->killed = curr->group->exiting;
+	intr_set_level (old_level);
+
+	sema_up (&args->started);
+	if (curr->killed)
+		thread_exit ();
+	do_iret (&if_);
+	NOT_REACHED ();
+}
+
+/* 같은 프로세스의 스레드 TID가 나갈 때까지 기다리고 thread_exit()에 넘긴
+ * 값을 반환한다.  그런 스레드가 없거나 이미 join됐으면 -1. */
+int
+process_join (tid_t tid) {
+	struct thread *curr = thread_current ();
+	struct uthread_info *info = NULL;
+	enum intr_level old_level;
+	struct list_elem *e;
+	int status;
+
+	if (curr->group == NULL || tid == curr->tid)
+		return -1;
+
+	old_level = intr_disable ();
+	for (e = list_begin (&curr->group->threads);
+			e != list_end (&curr->group->threads); e = list_next (e))
+		if (list_entry (e, struct uthread_info, elem)->tid == tid) {
+			info = list_entry (e, struct uthread_info, elem);
+			list_remove (&info->elem);      /* 두 번 join하지 못하게 */
+			break;
+		}
+	intr_set_level (old_level);
+	if (info == NULL)
+		return -1;
+
+	sema_down (&info->done);
+	status = info->exit_status;
+	free (info);
+	return status;
+}
+
+/* T가 스레드 묶음에서 나간다.  thread_exit()으로 나가는 clone한 스레드가
+ * 아니면 남은 스레드들도 끝나게 한다.  clone한 스레드는 공유하던 pml4와
+ * fd table을 놓고, leader는 다른 스레드가 모두 나갈 때까지 기다린 뒤 묶음을
+ * 해제한다.  그 다음 pml4와 fd table을 해제하는 것은 leader의 몫이다. */
+static void
+group_leave (struct thread *t) {
+	struct proc_group *group = t->group;
+	enum intr_level old_level;
+	struct list_elem *e;
+
+	old_level = intr_disable ();
+	list_remove (&t->group_elem);
+	if (!group->exiting && (t->uthread == NULL || !t->uthread->alone)) {
+		group->exiting = true;
+		group->exit_status = t->exit_status;
+		for (e = list_begin (&group->members); e != list_end (&group->members);
+				e = list_next (e))
+			list_entry (e, struct thread, group_elem)->killed = true;
+		futex_wake_killed ();
+	}
+
+	if (t->uthread != NULL) {
+		t->pml4 = NULL;
+		pml4_activate (NULL);
+		t->fd_table = NULL;
+		t->uthread->exit_status = t->exit_status;
+		sema_up (&t->uthread->done);
+		group->refcnt--;
+		sema_up (&group->leave);
+		intr_set_level (old_level);
+		t->group = NULL;
+		t->uthread = NULL;
+		return;
+	}
+
+	while (group->refcnt > 1)
+		sema_down (&group->leave);
+	group->refcnt--;
+	intr_set_level (old_level);
+
+	/* 다른 스레드가 끝낸 프로세스라면 그 종료 상태를 부모에게 넘긴다. */
+	t->exit_status = group->exit_status;
+
+	while (!list_empty (&group->threads))
+		free (list_entry (list_pop_front (&group->threads),
+					struct uthread_info, elem));
+	free (group);
+	t->group = NULL;
+}
+
 /* 현재의 실행 컨텍스트를 f_name으로 전환합니다.
  * 실패 시 -1을 반환합니다. */
 int
@@ -229,6 +462,12 @@ process_exec (void *f_name) {
     _if.cs = SEL_UCSEG;
     _if.eflags = FLAG_IF | FLAG_MBS;
 
+    /* 다른 스레드가 아직 쓰고 있는 주소 공간은 바꿀 수 없다. */
+    if (thread_current ()->group != NULL && thread_current ()->group->refcnt > 1) {
+        palloc_free_page (file_name);
+        return -1;
+    }
+
     /* 먼저 현재 컨텍스트를 종료합니다. */
     process_cleanup ();
 
@@ -271,7 +510,7 @@ process_wait (tid_t child_tid UNUSED) {
 	struct thread* parent = thread_current();
 	struct child_info *child = get_child_with_pid(child_tid, &parent->child_list);
 
-    if (!child_tid)
+    if (!child_tid || child == NULL)
         return -1;
 	
 	sema_down(&child->child_t->wait_sema);      // 자식 실행 중일 때 부모 잠들기
@@ -279,7 +518,7 @@ process_wait (tid_t child_tid UNUSED) {
     /* child : exit!!! */
 	int exit_status = child->exit_status;
 	list_remove(&child->c_elem);
-    free(child);
+    kmem_cache_free(child_cache, child);
 
 	return exit_status;
 
@@ -299,20 +538,29 @@ process_wait (tid_t child_tid UNUSED) {
 void
 process_exit (void) {
 	struct thread *t = thread_current ();
-	for (int i=2; i<FDT_COUNT_LIMIT; i++) {
-        close(i);
+    bool leader = t->uthread == NULL;
+
+    /* clone한 스레드는 여기서 공유하던 것들을 놓고, leader는 그들을 기다린다. */
+    if (t->group != NULL)
+        group_leave (t);
+    if (t->fd_table != NULL) {  // 유저 프로세스가 된 적 없는 커널 스레드는 fd table이 없다
+        for (int i=2; i<FDT_COUNT_LIMIT; i++) {
+            close(i);
+        }
     }
     file_close(t->running);
-    if (t->parent != NULL) { // 부모가 살아있는 경우, 부모가 먼저 죽어있을 수도 있음
+    if (leader && t->parent != NULL) { // 부모가 살아있는 경우, 부모가 먼저 죽어있을 수도 있음
         struct child_info *info = get_child_with_pid(t->tid, &t->parent->child_list);  // 내 유서
-        info->exit_status = t->exit_status; // 내 사망원인 수정
+        if (info != NULL)
+            info->exit_status = t->exit_status; // 내 사망원인 수정
     }
     palloc_free_page(t->fd_table);
+    t->fd_table = NULL;
     
     while (!list_empty(&t->child_list)) {
         struct child_info *ch_info = list_entry(list_pop_front(&t->child_list), struct child_info, c_elem);
         ch_info->child_t->parent = NULL; // 자식한테 "아빠 죽는다~" 알려주기
-        free(ch_info);
+        kmem_cache_free(child_cache, ch_info);
     }
 
     sema_up(&t->wait_sema);    // 종료할거라고 부모에게 알려줌
@@ -328,6 +576,9 @@ process_cleanup (void) {
     supplemental_page_table_kill (&curr->spt);
 #endif
 
+    /* 이 프로세스의 FPU 상태는 더 이상 필요 없다. */
+    fpu_release (curr);
+
     uint64_t *pml4;
     /* Destroy the current process's page directory and switch back
      * to the kernel-only page directory. */
@@ -13,13 +13,15 @@
 #include "filesys/directory.h"
 // #include "string.h"
 
+#include "userprog/futex.h"
 #include "userprog/process.h"
 #include "threads/palloc.h"
 void syscall_entry (void);
 void syscall_handler (struct intr_frame *);
 void is_valid_addr(const char *file);
 
-struct lock filesys_lock;
+/* 파일 읽기는 함께, 쓰기는 혼자 */
+struct rwlock filesys_lock;
 
 /* 시스템 호출.
  *
@@ -42,7 +44,9 @@ syscall_init (void) {
             ((uint64_t)SEL_KCSEG) << 32);
     write_msr(MSR_LSTAR, (uint64_t) syscall_entry);
 
-    lock_init(&filesys_lock);
+    rw_init(&filesys_lock);
+    lock_set_name(&filesys_lock.lock, "filesys_lock");
+    futex_init();
 
     /* 시스템 호출 진입점이 사용자 영역 스택을 커널 모드 스택으로 교체할 때까지
         인터럽트 서비스 루틴은 어떠한 인터럽트도 처리해서는 안 됩니다.
@@ -139,20 +143,26 @@ int open (const char *file) {
 int add_file_to_fd_table(struct file *file) {
     struct thread *t = thread_current();
     struct file **fdt = t->fd_table;
+    struct proc_group *group = t->group;
+    enum intr_level old_level;
     int i = 1, fd = -1;
+
+    /* fd table과 fd_cnt는 같은 프로세스의 스레드들이 함께 쓴다. */
+    old_level = intr_disable();
     for (i = 2; i < FDT_COUNT_LIMIT; i++) {
         if (fdt[i] == NULL) {
             fdt[i] = file;
             fd = i;
-            if (i > t->fd_cnt) {
-                t->fd_cnt = i;
+            if (i > group->fd_cnt) {
+                group->fd_cnt = i;
             }
             break;
         }
     }
     if (i == FDT_COUNT_LIMIT) {
-        t->fd_cnt = FDT_COUNT_LIMIT;
+        group->fd_cnt = FDT_COUNT_LIMIT;
     }
+    intr_set_level(old_level);
     return fd;
 }
 
@@ -187,9 +197,11 @@ int read(int fd, void *buffer, unsigned size) {
         struct file *f = get_file_by_fd(fd);
         if(f == NULL)
             exit(-1);
-        lock_acquire(&filesys_lock);
+        /* 다른 파일을 읽는 스레드와는 함께 읽는다.  같은 struct file의
+           위치는 file_read()가 그 파일의 pos_lock으로 지킨다. */
+        rw_read_acquire(&filesys_lock);
         read_count = file_read(f, buffer, size);
-        lock_release(&filesys_lock);
+        rw_read_release(&filesys_lock);
     }
     return read_count;
 }
@@ -207,9 +219,9 @@ int write (int fd, const void *buffer, unsigned size) {
         struct file *f = get_file_by_fd(fd);
 	    if (f == NULL)
 		    return 0;
-        lock_acquire(&filesys_lock);
+        rw_write_acquire(&filesys_lock);
         write_count = file_write(f, buffer, size);
-        lock_release(&filesys_lock);
+        rw_write_release(&filesys_lock);
     }
 
 	return write_count;
@@ -244,12 +256,18 @@ unsigned tell (int fd) {
 void close (int fd) {
     struct file *f = get_file_by_fd(fd);
     struct thread* curr = thread_current();
+    enum intr_level old_level;
 
     if(f == NULL)
         return;
-    
-    file_close(f);
+
+    /* 같은 fd를 다른 스레드가 함께 닫아도 한 번만 닫는다. */
+    old_level = intr_disable();
+    f = curr->fd_table[fd];
     curr->fd_table[fd] = NULL;
+    intr_set_level(old_level);
+    if (f != NULL)
+        file_close(f);
 }
 
 /* 파일을 삭제하는 시스템 콜 */
@@ -258,6 +276,36 @@ bool remove (const char *file) {
     return filesys_remove(file);
 }
 
+/* 현재 스레드의 스케줄링 통계를 stats에 복사 */
+bool threadstats (struct thread_stats *stats) {
+    is_valid_addr((const char *) stats);
+    is_valid_addr((const char *) stats + sizeof *stats - 1);
+    thread_get_stats(thread_current(), stats);
+    return true;
+}
+
+/* 이 프로세스 안에 stack에서 entry (arg)를 실행하는 스레드를 만든다. */
+tid_t clone (void *entry, void *arg, void *stack, struct intr_frame *f) {
+    if (!is_user_vaddr(entry) || !is_user_vaddr(stack))
+        return TID_ERROR;
+    return process_clone(entry, arg, stack, f);
+}
+
+/* 같은 프로세스의 스레드 tid가 끝나기를 기다려 종료 상태를 가져온다. */
+int join (tid_t tid) {
+    return process_join(tid);
+}
+
+/* 호출한 스레드만 끝낸다.  프로세스의 처음 스레드라면 exit()과 같다. */
+void exit_thread (int status) {
+    struct thread *curr = thread_current();
+
+    if (curr->uthread == NULL)
+        exit(status);
+    curr->exit_status = status;
+    curr->uthread->alone = true;
+    thread_exit();
+}
 
 /* 주요 시스템 호출 인터페이스 */
 void
@@ -323,7 +371,40 @@ syscall_handler (struct intr_frame *f) {
             close (f->R.rdi);
             break;
 
+        case SYS_THREADSTATS:
+            f->R.rax = threadstats (f->R.rdi);
+            break;
+
+        case SYS_CLONE:
+#ifdef VM
+            /* spt가 스레드마다 따로 있어서 아직 주소 공간을 공유할 수 없다. */
+            f->R.rax = TID_ERROR;
+#else
+            f->R.rax = clone (f->R.rdi, f->R.rsi, f->R.rdx, f);
+#endif
+            break;
+
+        case SYS_THREAD_JOIN:
+            f->R.rax = join (f->R.rdi);
+            break;
+
+        case SYS_THREAD_EXIT:
+            exit_thread (f->R.rdi);
+            break;
+
+        case SYS_FUTEX_WAIT:
+            f->R.rax = futex_wait (f->R.rdi, f->R.rsi);
+            break;
+
+        case SYS_FUTEX_WAKE:
+            f->R.rax = futex_wake (f->R.rdi, f->R.rsi);
+            break;
+
         default:
             break;                                                                                                      
     }
+
+    /* 같은 프로세스의 다른 스레드가 프로세스를 끝냈으면 유저 모드로 돌아가지 않는다. */
+    if (curr->killed)
+        thread_exit();
 }